@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// bitvector.hpp
+// Klasse BitVector implementiert eine dichte Bitmenge über Symbolindizes
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_BITVECTOR_HPP__
+#define __WEGEL_TDBP_BITVECTOR_HPP__
+
+#include <vector>
+#include <boost/cstdint.hpp>
+
+/// Maschinenwort einer Bitmenge
+typedef boost::uint64_t BitWord;
+
+/// Dichte Bitmenge über Symbolindizes
+/** Speichert eine Menge kleiner Ganzzahlen als Folge von 64-Bit-Wörtern.
+  * Die statischen Kernfunktionen arbeiten wortweise auf rohen Wortfolgen,
+  * damit der Compiler sie vektorisieren kann und Charts ihre Zellen in
+  * einem zusammenhängenden Speicherblock halten können.
+  */
+class BitVector
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor einer leeren Menge ohne Platz
+	BitVector()
+	{
+	}
+
+	/// Konstruktor einer leeren Menge für eine Anzahl von Elementen
+	/** @param bits Anzahl möglicher Elemente
+	  */
+	BitVector(const unsigned bits) : storage(words_for(bits),0)
+	{
+	}
+
+	/// Fügt ein Element hinzu
+	void set(const unsigned i)
+	{
+		storage[i/64] |= BitWord(1) << (i%64);
+	}
+
+	/// Prüft, ob ein Element enthalten ist
+	bool test(const unsigned i) const
+	{
+		return (storage[i/64] >> (i%64)) & 1;
+	}
+
+	/// Gibt die Anzahl der Wörter aus
+	unsigned words() const
+	{
+		return storage.size();
+	}
+
+	/// Gibt die Wortfolge aus
+	const BitWord* data() const
+	{
+		return storage.empty() ? 0 : &storage[0];
+	}
+
+	/// Gibt die veränderbare Wortfolge aus
+	BitWord* data()
+	{
+		return storage.empty() ? 0 : &storage[0];
+	}
+
+	/// Vereinigt eine andere Menge gleicher Größe mit dieser
+	/** @param rhs Andere Menge
+	    @return Menge hat sich verändert ja/nein
+	  */
+	bool unite(const BitVector& rhs)
+	{
+		return or_into(data(),rhs.data(),words());
+	}
+
+	/// Prüft, ob zwei Mengen gleicher Größe gemeinsame Elemente haben
+	bool intersects(const BitVector& rhs) const
+	{
+		return intersects(data(),rhs.data(),words());
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+	// Kernfunktionen auf Wortfolgen
+
+	/// Liefert die Anzahl der Wörter für eine Anzahl von Elementen
+	static unsigned words_for(const unsigned bits)
+	{
+		return (bits+63)/64;
+	}
+
+	/// Prüft, ob ein Element in einer Wortfolge enthalten ist
+	static bool test(const BitWord* set, const unsigned i)
+	{
+		return (set[i/64] >> (i%64)) & 1;
+	}
+
+	/// Vereinigt eine Wortfolge mit einer anderen
+	/** @param dst Ziel, wird um src erweitert
+	    @param src Quelle
+	    @param n Anzahl der Wörter
+	    @return Ziel hat sich verändert ja/nein
+	  */
+	static bool or_into(BitWord* dst, const BitWord* src, const unsigned n)
+	{
+		BitWord changed = 0;
+		for(unsigned i = 0; i < n; ++i)
+		{
+			changed |= src[i] & ~dst[i];
+			dst[i] |= src[i];
+		}
+		return changed != 0;
+	}
+
+	/// Schneidet zwei Wortfolgen
+	/** @param dst Ziel für die Schnittmenge
+	    @param a Erste Wortfolge
+	    @param b Zweite Wortfolge
+	    @param n Anzahl der Wörter
+	    @return Schnittmenge nicht leer ja/nein
+	  */
+	static bool and_into(BitWord* dst, const BitWord* a, const BitWord* b,
+	                     const unsigned n)
+	{
+		BitWord any = 0;
+		for(unsigned i = 0; i < n; ++i)
+		{
+			dst[i] = a[i] & b[i];
+			any |= dst[i];
+		}
+		return any != 0;
+	}
+
+	/// Prüft, ob zwei Wortfolgen gemeinsame Elemente haben
+	static bool intersects(const BitWord* a, const BitWord* b, const unsigned n)
+	{
+		BitWord any = 0;
+		for(unsigned i = 0; i < n; ++i)
+		{
+			any |= a[i] & b[i];
+		}
+		return any != 0;
+	}
+
+	/// Liefert den Index des niedrigsten gesetzten Bits eines Wortes
+	/** @param w Wort, nicht 0
+	    @return Bitindex
+	  */
+	static unsigned lowest_bit(BitWord w)
+	{
+#ifdef __GNUC__
+		return __builtin_ctzll(w);
+#else
+		unsigned i = 0;
+		while(!(w & 1))
+		{
+			w >>= 1;
+			++i;
+		}
+		return i;
+#endif
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	std::vector<BitWord> storage;	///< Wörter der Menge
+};
+
+#endif
@@ -0,0 +1,517 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// compiledgrammar.hpp
+// Klasse CompiledGrammar hält Grammatik und Lexikon mit Symbolindizes
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_COMPILEDGRAMMAR_HPP__
+#define __WEGEL_TDBP_COMPILEDGRAMMAR_HPP__
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+#include "globaltypes.hpp"
+#include "symboltable.hpp"
+#include "bitvector.hpp"
+#include "flatarray.hpp"
+#include "lexiconentries.hpp"
+
+/// Übersetzte separierte Grammatik
+/** Übersetzt die eingelesenen Produktions- und Lexikonregeln einmalig in
+  * eine Form, in der alle Symbole und Terminale kleine Ganzzahlen sind.
+  * Alle Parsing-Verfahren arbeiten nur auf dieser Form; die Strings werden
+  * erst bei der Ausgabe der Bäume wieder gebraucht.
+  *
+  * Regeln und Kategorien liegen in zusammenhängenden Feldern: Die Regeln
+  * eines Symbols sind ein Abschnitt der Regeltabelle, die rechte Seite
+  * einer Regel ist ein Abschnitt eines flachen Symbolfeldes. Abschnitt i
+  * reicht jeweils von offsets[i] bis vor offsets[i+1].
+  *
+  * Zu jedem Symbol und jeder Regel wird außerdem als Bitmenge die Menge
+  * der Präterminale abgelegt, mit denen ihre Ableitungen beginnen können,
+  * sowie die Mindestzahl an Tokens, die ihre Ableitungen überdecken.
+  */
+class CompiledGrammar
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Index einer Regel in der Regeltabelle
+	typedef unsigned RuleId;
+
+	/// Mindestlänge von Symbolen, die gar keine Ableitung haben
+	enum {NO_YIELD = 0x7fffffff};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor einer leeren Grammatik
+	CompiledGrammar()
+	{
+		start_symbol = 0;
+		words = 0;
+	}
+
+	/// Übersetzt Grammatik und Lexikon
+	/** Vergibt Indizes für alle Symbole und Terminale und packt die Regeln
+	  * und Lexikoneinträge über diesen Indizes in flache Felder. Das
+	  * Startsymbol s erhält immer einen Index, auch wenn es keine Regeln hat.
+	  * Die Terminale behalten die Indizes, die sie beim Einlesen erhalten
+	  * haben. Doppelte Regeln werden nur einmal übernommen, sodass jede
+	  * Ableitung einen eigenen Baum ergibt.
+	    @param g Produktionsregeln der Grammatik
+	    @param l Lexikonregeln
+	  */
+	void compile(const Grammar& g, const LexiconEntries& l)
+	{
+		start_symbol = symbols.intern(Symbol("s"));
+
+		// Sammle die Regeln zunächst pro Symbol
+		std::vector<std::vector<SymbolIdList> > rules;
+		std::set<std::pair<SymbolId,SymbolIdList> > known;
+		for(Grammar::const_iterator i = g.begin(); i != g.end(); ++i)
+		{
+			SymbolId lhs = symbols.intern(i->first);
+			for(SymbolListList::const_iterator r = i->second.begin();
+			    r != i->second.end(); ++r)
+			{
+				SymbolIdList rhs;
+				for(SymbolList::const_iterator s = r->begin(); s != r->end(); ++s)
+				{
+					rhs.push_back(symbols.intern(*s));
+				}
+				if(rules.size() <= lhs)
+				{
+					rules.resize(lhs+1);
+				}
+				if(known.insert(std::make_pair(lhs,rhs)).second)
+				{
+					rules[lhs].push_back(rhs);
+				}
+			}
+		}
+
+		// Lexikonregeln: Tokens übernehmen, Kategorien in Symbole umrechnen
+		tokens = l.token_table();
+		const SymbolTable& cats = l.category_table();
+		std::vector<SymbolId> category_ids(cats.size());
+		for(SymbolId c = 0; c < category_ids.size(); ++c)
+		{
+			category_ids[c] = symbols.intern(cats.name(c));
+		}
+		rules.resize(symbols.size());
+
+		// Packe die Regeln in die flachen Felder
+		rule_offsets.assign(1,0);
+		rhs_offsets.assign(1,0);
+		rhs_symbols.clear();
+		for(SymbolId s = 0; s < rules.size(); ++s)
+		{
+			for(std::vector<SymbolIdList>::const_iterator r = rules[s].begin();
+			    r != rules[s].end(); ++r)
+			{
+				rhs_symbols.append(r->begin(),r->end());
+				rhs_offsets.push_back(rhs_symbols.size());
+			}
+			rule_offsets.push_back(rhs_offsets.size()-1);
+		}
+
+		// Packe die Kategorien nach Tokens sortiert, pro Token sortiert und
+		// ohne doppelte Einträge für die binäre Suche
+		const LexiconEntries::EntryList& entries = l.list();
+		std::vector<unsigned> first(tokens.size()+1,0);
+		for(LexiconEntries::EntryList::const_iterator e = entries.begin();
+		    e != entries.end(); ++e)
+		{
+			++first[e->first+1];
+		}
+		for(TokenId t = 0; t < tokens.size(); ++t)
+		{
+			first[t+1] += first[t];
+		}
+		SymbolIdList sorted(entries.size());
+		std::vector<unsigned> fill(first.begin(),first.end()-1);
+		for(LexiconEntries::EntryList::const_iterator e = entries.begin();
+		    e != entries.end(); ++e)
+		{
+			sorted[fill[e->first]++] = category_ids[e->second];
+		}
+		category_offsets.assign(1,0);
+		category_symbols.clear();
+		for(TokenId t = 0; t < tokens.size(); ++t)
+		{
+			SymbolIdList::iterator begin = sorted.begin()+first[t];
+			SymbolIdList::iterator end = sorted.begin()+first[t+1];
+			std::sort(begin,end);
+			category_symbols.append(begin,std::unique(begin,end));
+			category_offsets.push_back(category_symbols.size());
+		}
+
+		// Beide Tabellen werden nur noch durchsucht
+		symbols.freeze();
+		tokens.freeze();
+
+		compute_first();
+		compute_min_yield();
+	}
+
+	/// Liefert den Index des Startsymbols
+	SymbolId start() const
+	{
+		return start_symbol;
+	}
+
+	/// Gibt die Anzahl der Symbole aus
+	unsigned symbol_count() const
+	{
+		return symbols.size();
+	}
+
+	/// Gibt die Anzahl der Regeln aus
+	unsigned rule_count() const
+	{
+		return rhs_offsets.size()-1;
+	}
+
+	/// Prüft, ob ein Symbol ein Präterminal ist, also keine Regeln hat
+	bool is_preterminal(const SymbolId s) const
+	{
+		return rule_offsets[s] == rule_offsets[s+1];
+	}
+
+	/// Liefert die erste Regel eines Symbols
+	RuleId rules_begin(const SymbolId s) const
+	{
+		return rule_offsets[s];
+	}
+
+	/// Liefert die Regel hinter der letzten Regel eines Symbols
+	RuleId rules_end(const SymbolId s) const
+	{
+		return rule_offsets[s+1];
+	}
+
+	/// Liefert den Anfang der rechten Seite einer Regel
+	const SymbolId* rhs_begin(const RuleId r) const
+	{
+		return rhs_symbols.data()+rhs_offsets[r];
+	}
+
+	/// Liefert das Ende der rechten Seite einer Regel
+	const SymbolId* rhs_end(const RuleId r) const
+	{
+		return rhs_symbols.data()+rhs_offsets[r+1];
+	}
+
+	/// Gibt die Länge der rechten Seite einer Regel aus
+	unsigned rhs_length(const RuleId r) const
+	{
+		return rhs_offsets[r+1]-rhs_offsets[r];
+	}
+
+	/// Gibt die Anzahl der Wörter einer Bitmenge über den Symbolen aus
+	unsigned set_words() const
+	{
+		return words;
+	}
+
+	/// Liefert die Präterminale, mit denen ein Symbol beginnen kann
+	const BitWord* first_of(const SymbolId s) const
+	{
+		return &symbol_first[s*words];
+	}
+
+	/// Liefert die Präterminale, mit denen eine Regel beginnen kann
+	const BitWord* first_of_rule(const RuleId r) const
+	{
+		return first_of(rhs_symbols[rhs_offsets[r]]);
+	}
+
+	/// Gibt die Mindestzahl an Tokens aus, die ein Symbol überdeckt
+	unsigned min_yield(const SymbolId s) const
+	{
+		return symbol_yield[s];
+	}
+
+	/// Gibt die Mindestzahl an Tokens aus, die eine Regel überdeckt
+	unsigned min_yield_of_rule(const RuleId r) const
+	{
+		return rule_yield[r];
+	}
+
+	/// Addiert zwei Mindestlängen, ohne NO_YIELD zu überschreiten
+	static unsigned add_yield(const unsigned a, const unsigned b)
+	{
+		return a >= NO_YIELD-b ? unsigned(NO_YIELD) : a+b;
+	}
+
+	/// Trägt die Kategorien eines Terminals in eine Bitmenge ein
+	/** @param t Terminal
+	    @param set Wortfolge mit set_words() Wörtern
+	  */
+	void categories_into(const TokenId t, BitWord* set) const
+	{
+		for(const SymbolId* c = categories_begin(t); c != categories_end(t); ++c)
+		{
+			set[*c/64] |= BitWord(1) << (*c%64);
+		}
+	}
+
+	/// Sucht den Index eines Terminals
+	/** @param t Terminal
+	    @param id Gefundener Index
+	    @return Lexikonregel vorhanden ja/nein
+	  */
+	bool find_token(const Token& t, TokenId& id) const
+	{
+		return tokens.find(t,id);
+	}
+
+	/// Liefert den Anfang der sortierten Kategorien eines Terminals
+	const SymbolId* categories_begin(const TokenId t) const
+	{
+		return category_symbols.data()+category_offsets[t];
+	}
+
+	/// Liefert das Ende der sortierten Kategorien eines Terminals
+	const SymbolId* categories_end(const TokenId t) const
+	{
+		return category_symbols.data()+category_offsets[t+1];
+	}
+
+	/// Prüft, ob es eine Lexikonregel Symbol -> Terminal gibt
+	bool has_category(const TokenId t, const SymbolId s) const
+	{
+		return std::binary_search(categories_begin(t),categories_end(t),s);
+	}
+
+	/// Liefert die Tabelle der Symbole
+	const SymbolTable& symbol_table() const
+	{
+		return symbols;
+	}
+
+	/// Liefert die Tabelle der Terminale
+	const SymbolTable& token_table() const
+	{
+		return tokens;
+	}
+
+	/// Übergibt alle Daten der Grammatik an einen Besucher
+	/** Dient dem Schreiben und Einblenden der Cache-Datei. Der Besucher
+	  * wird mit jeder Zahl und jedem flachen Feld aufgerufen, immer in
+	  * derselben Reihenfolge.
+	    @param visitor Funktionsobjekt
+	  */
+	template<typename Visitor>
+	void visit(Visitor& visitor)
+	{
+		visitor(start_symbol);
+		visitor(words);
+		symbols.visit(visitor);
+		tokens.visit(visitor);
+		visitor(rule_offsets);
+		visitor(rhs_offsets);
+		visitor(rhs_symbols);
+		visitor(category_offsets);
+		visitor(category_symbols);
+		visitor(symbol_first);
+		visitor(symbol_yield);
+		visitor(rule_yield);
+	}
+
+	/// Prüft die Felder einer eingeblendeten Grammatik
+	/** Die Indizes in den Feldern werden ohne weitere Prüfung verwendet.
+	  * Eine beschädigte oder fremde Cache-Datei muss daher vor dem Parsen
+	  * abgewiesen werden: Alle Offsets müssen aufsteigend in ihren Feldern
+	  * liegen, jede rechte Seite ein Symbol haben und alle Symbole und
+	  * Größen zu den Symboltabellen passen.
+	    @return Grammatik gültig ja/nein
+	  */
+	bool valid() const
+	{
+		if(!symbols.valid() || !tokens.valid())
+		{
+			return false;
+		}
+		const unsigned n = symbols.size();
+		if(start_symbol >= n || words != BitVector::words_for(n) ||
+		   rhs_offsets.empty() ||
+		   !valid_offsets(rule_offsets,n,rhs_offsets.size()-1) ||
+		   !valid_offsets(rhs_offsets,rhs_offsets.size()-1,rhs_symbols.size()) ||
+		   !valid_offsets(category_offsets,tokens.size(),
+		                  category_symbols.size()) ||
+		   !valid_ids(rhs_symbols,n) || !valid_ids(category_symbols,n) ||
+		   symbol_first.size() != n*words || symbol_yield.size() != n ||
+		   rule_yield.size() != rule_count())
+		{
+			return false;
+		}
+		for(RuleId r = 0; r < rule_count(); ++r)
+		{
+			if(rhs_length(r) == 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Hält den Speicher fest, in den eingeblendete Felder zeigen
+	/** @param mapping Eingeblendete Cache-Datei
+	  */
+	void attach(const boost::shared_ptr<void>& mapping)
+	{
+		storage = mapping;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	SymbolTable symbols;				///< Symbole der Grammatik
+	SymbolTable tokens;					///< Terminale des Lexikons
+	SymbolId start_symbol;				///< Index des Startsymbols s
+	FlatArray<RuleId> rule_offsets;		///< Symbol -> erste Regel
+	FlatArray<unsigned> rhs_offsets;		///< Regel -> Beginn der rechten Seite
+	FlatArray<SymbolId> rhs_symbols;		///< Rechte Seiten aller Regeln
+	FlatArray<unsigned> category_offsets;	///< Terminal -> erste Kategorie
+	FlatArray<SymbolId> category_symbols;	///< Kategorien aller Terminale
+	unsigned words;							///< Wörter pro Bitmenge
+	FlatArray<BitWord> symbol_first;		///< Symbol -> erste Präterminale
+	FlatArray<unsigned> symbol_yield;		///< Symbol -> Mindestlänge
+	FlatArray<unsigned> rule_yield;		///< Regel -> Mindestlänge
+	boost::shared_ptr<void> storage;		///< Eingeblendete Cache-Datei oder 0
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Prüft ein Feld von Offsets auf count Einträge und ein Feld der Länge total
+	static bool valid_offsets(const FlatArray<unsigned>& offsets,
+	                          const unsigned count, const unsigned total)
+	{
+		if(offsets.size() != count+1 || offsets[0] != 0 ||
+		   offsets[count] != total)
+		{
+			return false;
+		}
+		for(unsigned i = 1; i <= count; ++i)
+		{
+			if(offsets[i] < offsets[i-1])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Prüft, ob alle Symbole eines Feldes kleiner als n sind
+	static bool valid_ids(const FlatArray<SymbolId>& ids, const unsigned n)
+	{
+		for(unsigned i = 0; i < ids.size(); ++i)
+		{
+			if(ids[i] >= n)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Berechnet die Mengen erster Präterminale
+	/** Ein Präterminal beginnt mit sich selbst, ein Nichtterminal mit allem,
+	  * womit das erste Symbol einer seiner Regeln beginnt. Wegen
+	  * Linksrekursion wird bis zum Fixpunkt iteriert.
+	  */
+	void compute_first()
+	{
+		words = BitVector::words_for(symbols.size());
+		symbol_first.assign(symbols.size()*words,0);
+		for(SymbolId s = 0; s < symbols.size(); ++s)
+		{
+			if(is_preterminal(s))
+			{
+				symbol_first[s*words+s/64] |= BitWord(1) << (s%64);
+			}
+		}
+		bool changed = true;
+		while(changed)
+		{
+			changed = false;
+			for(SymbolId s = 0; s < symbols.size(); ++s)
+			{
+				for(RuleId r = rules_begin(s); r != rules_end(s); ++r)
+				{
+					SymbolId first = rhs_symbols[rhs_offsets[r]];
+					if(first != s &&
+					   BitVector::or_into(&symbol_first[s*words],
+					                      &symbol_first[first*words],words))
+					{
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	/// Berechnet die Mindestlängen der Symbole und Regeln
+	/** Die separierte Grammatik hat keine leeren Regeln, jedes Präterminal
+	  * überdeckt also genau ein Token. Ein Nichtterminal überdeckt
+	  * mindestens so viele Tokens wie seine kürzeste Regel, die Summe über
+	  * ihre rechte Seite. Bis zum Fixpunkt wird iteriert; Symbole ohne
+	  * Ableitung behalten NO_YIELD.
+	  */
+	void compute_min_yield()
+	{
+		symbol_yield.assign(symbols.size(),unsigned(NO_YIELD));
+		rule_yield.assign(rule_count(),unsigned(NO_YIELD));
+		for(SymbolId s = 0; s < symbols.size(); ++s)
+		{
+			if(is_preterminal(s))
+			{
+				symbol_yield[s] = 1;
+			}
+		}
+		bool changed = true;
+		while(changed)
+		{
+			changed = false;
+			for(SymbolId s = 0; s < symbols.size(); ++s)
+			{
+				for(RuleId r = rules_begin(s); r != rules_end(s); ++r)
+				{
+					unsigned yield = 0;
+					for(const SymbolId* c = rhs_begin(r); c != rhs_end(r); ++c)
+					{
+						yield = add_yield(yield,symbol_yield[*c]);
+					}
+					rule_yield[r] = yield;
+					if(yield < symbol_yield[s])
+					{
+						symbol_yield[s] = yield;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+};
+
+#endif
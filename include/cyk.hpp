@@ -0,0 +1,494 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// cyk.hpp
+// Klasse CYKParser implementiert einen bitparallelen CYK-Parser
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_CYK_HPP__
+#define __WEGEL_TDBP_CYK_HPP__
+
+#include <vector>
+#include <map>
+#include <boost/unordered_map.hpp>
+#include "globaltypes.hpp"
+#include "compiledgrammar.hpp"
+#include "bitvector.hpp"
+#include "forest.hpp"
+
+/// Bitparalleler CYK-Parser
+/** Binarisiert die Produktionsregeln der separierten Grammatik automatisch
+  * und erkennt einen Satz bottom-up in einem Chart, dessen Zellen die
+  * erkannten Symbole als dichte Bitmengen halten. Einstellige Regeln werden
+  * pro Zelle über einen Abschluss behandelt. Aus dem Chart wird ein
+  * gepackter Parsewald über den ursprünglichen Regeln aufgebaut, sodass die
+  * Binarisierung in den ausgegebenen Bäumen nicht mehr sichtbar ist.
+  */
+class CYKParser
+{
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Ursprüngliche Produktionsregel mit Symbolen als Indizes
+	/** Zu jedem Präfix der Länge 2 bis n-1 gehört ein künstliches Symbol
+	  * der binarisierten Grammatik: P(d) -> P(d-1) B(d), P(1) = B(1),
+	  * A -> P(n-1) B(n). Regeln mit gleichem Präfix teilen sich das Symbol.
+	  */
+	struct Rule
+	{
+		int					lhs;		///< Symbol der linken Regelseite
+		std::vector<int>	rhs;		///< Symbole der rechten Regelseite
+		std::vector<int>	prefixes;	///< Präfixlänge-1 -> Symbol P
+	};
+
+	/// Paar von Symbolen der rechten Seite einer binären Regel
+	typedef std::pair<int,int> SymbolPair;
+
+	/// Schlüssel eines Knotens im Wald: Symbol, Präfixlänge, Spanne
+	typedef std::pair<std::pair<int,unsigned>,std::pair<unsigned,unsigned> >
+		NodeKey;
+
+	/// Map Schlüssel -> Index des Knotens im Wald
+	typedef boost::unordered_map<NodeKey,int> NodeMap;
+
+	/// Knoten des Waldes, dessen Alternativen noch fehlen
+	struct Task
+	{
+		int			node;	///< Index des Knotens im Wald
+		int			label;	///< Symbol oder Regel des Knotens
+		unsigned	dot;	///< Länge des Regelpräfixes, 0 bei Symbolknoten
+		unsigned	begin;	///< Erste Position der Spanne
+		unsigned	end;	///< Position hinter der Spanne
+
+		/// Konstruktor aus Knoten, Symbol oder Regel, Präfixlänge und Spanne
+		Task(int n, int l, unsigned d, unsigned b, unsigned e)
+		{
+			node = n;
+			label = l;
+			dot = d;
+			begin = b;
+			end = e;
+		}
+	};
+
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor aus einer übersetzten Grammatik
+	/** Übersetzt die Produktionsregeln in eine binarisierte Form und legt
+	  * die Bitmengen für die Kombination von Zellen an.
+	    @param g Übersetzte Grammatik
+	  */
+	CYKParser(const CompiledGrammar& g) : grammar(g)
+	{
+		// Übernimm die Produktionsregeln
+		originals = grammar.symbol_count();
+		for(SymbolId s = 0; s < originals; ++s)
+		{
+			for(CompiledGrammar::RuleId r = grammar.rules_begin(s);
+			    r != grammar.rules_end(s); ++r)
+			{
+				Rule rule;
+				rule.lhs = s;
+				rule.rhs.assign(grammar.rhs_begin(r),grammar.rhs_end(r));
+				rules.push_back(rule);
+			}
+		}
+
+		// Binarisiere: ein künstliches Symbol für jedes echte Präfix
+		symbols = originals;
+		std::map<std::vector<int>,int> prefix_ids;
+		for(unsigned r = 0; r < rules.size(); ++r)
+		{
+			Rule& rule = rules[r];
+			unsigned n = rule.rhs.size();
+			rule.prefixes.assign(n,-1);
+			rule.prefixes[0] = rule.rhs[0];
+			for(unsigned d = 1; d+1 < n; ++d)
+			{
+				std::vector<int> prefix(rule.rhs.begin(),rule.rhs.begin()+d+1);
+				std::map<std::vector<int>,int>::const_iterator p =
+					prefix_ids.find(prefix);
+				if(p == prefix_ids.end())
+				{
+					prefix_ids[prefix] = symbols;
+					rule.prefixes[d] = symbols++;
+				}
+				else
+				{
+					rule.prefixes[d] = p->second;
+				}
+			}
+		}
+		words = BitVector::words_for(symbols);
+
+		// Lege die Bitmengen der binarisierten Regeln an
+		unary_of.assign(symbols,-1);
+		mask_of.assign(symbols,-1);
+		for(unsigned r = 0; r < rules.size(); ++r)
+		{
+			const Rule& rule = rules[r];
+			unsigned n = rule.rhs.size();
+			if(n == 1)
+			{
+				add_unary(rule.lhs,rule.rhs[0]);
+			}
+			for(unsigned d = 1; d < n; ++d)
+			{
+				int parent = d+1 == n ? rule.lhs : rule.prefixes[d];
+				add_binary(parent,rule.prefixes[d-1],rule.rhs[d]);
+			}
+		}
+	}
+
+	/// Parst einen tokenisierten Satz
+	/** Füllt das Chart bottom-up und baut bei Erfolg einen gepackten
+	  * Parsewald über den ursprünglichen Regeln auf.
+	    @param input Tokenindizes des Inputs
+	    @param forest Wald, in den die Bäume eingetragen werden
+	  */
+	void parse(const TokenIdList& input, ParseForest& forest)
+	{
+		tokens = &input;
+		length = input.size();
+		chart.assign((length+1)*(length+1)*words,0);
+		hits.assign(words,0);
+		fresh.assign(words,0);
+
+		// Zellen der Länge 1 mit den Präterminalen der Tokens
+		for(unsigned i = 0; i < length; ++i)
+		{
+			for(const SymbolId* c = grammar.categories_begin(input[i]);
+			    c != grammar.categories_end(input[i]); ++c)
+			{
+				if(grammar.is_preterminal(*c))
+				{
+					cell(i,i+1)[*c/64] |= BitWord(1) << (*c%64);
+				}
+			}
+			close_unary(cell(i,i+1));
+		}
+
+		// Längere Zellen aus allen Paaren kürzerer Zellen
+		for(unsigned span = 2; span <= length; ++span)
+		{
+			for(unsigned i = 0; i+span <= length; ++i)
+			{
+				unsigned j = i+span;
+				for(unsigned k = i+1; k < j; ++k)
+				{
+					combine(cell(i,k),cell(k,j),cell(i,j));
+				}
+				close_unary(cell(i,j));
+			}
+		}
+
+		// Baue den Wald auf, falls das Startsymbol den Input überspannt
+		if(length > 0 && contains(grammar.start(),0,length))
+		{
+			nodes.clear();
+			forest.set_root(symbol_node(forest,grammar.start(),0,length));
+			build_forest(forest);
+		}
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	const CompiledGrammar& grammar;	///< Übersetzte Grammatik
+	unsigned originals;				///< Anzahl der Symbole der Grammatik
+	unsigned symbols;				///< Anzahl inklusive künstlicher Symbole
+	std::vector<Rule> rules;		///< Regeln, Indizes wie in der Grammatik
+	unsigned words;					///< Wörter pro Bitmenge
+
+	std::vector<int> unary_of;				///< B -> Index in unary_parents
+	std::vector<BitVector> unary_parents;	///< {A | A -> B}
+	std::vector<int> mask_of;				///< B -> Index in right_masks
+	std::vector<BitVector> right_masks;		///< {C | A -> B C}
+	boost::unordered_map<SymbolPair,unsigned> binary_index; ///< (B,C) -> Index
+	std::vector<BitVector> binary_parents;	///< Index -> {A | A -> B C}
+
+	const TokenIdList* tokens;		///< Input-Tokens
+	unsigned length;				///< Anzahl der Input-Tokens
+	std::vector<BitWord> chart;		///< Zellen (i,j) als Bitmengen
+	NodeMap nodes;					///< Bereits angelegte Knoten des Waldes
+	std::vector<Task> tasks;		///< Knoten ohne Alternativen
+	std::vector<BitWord> hits;		///< Puffer von combine, einmal pro Satz
+	std::vector<BitWord> fresh;		///< Puffer von close_unary
+	std::vector<int> agenda;		///< Arbeitsliste von close_unary
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Trägt eine einstellige Regel A -> B ein
+	void add_unary(const int a, const int b)
+	{
+		if(unary_of[b] == -1)
+		{
+			unary_of[b] = unary_parents.size();
+			unary_parents.push_back(BitVector(symbols));
+		}
+		unary_parents[unary_of[b]].set(a);
+	}
+
+	/// Trägt eine binäre Regel A -> B C ein
+	void add_binary(const int a, const int b, const int c)
+	{
+		if(mask_of[b] == -1)
+		{
+			mask_of[b] = right_masks.size();
+			right_masks.push_back(BitVector(symbols));
+		}
+		right_masks[mask_of[b]].set(c);
+		SymbolPair key(b,c);
+		boost::unordered_map<SymbolPair,unsigned>::const_iterator i =
+			binary_index.find(key);
+		if(i == binary_index.end())
+		{
+			binary_index[key] = binary_parents.size();
+			binary_parents.push_back(BitVector(symbols));
+			binary_parents.back().set(a);
+		}
+		else
+		{
+			binary_parents[i->second].set(a);
+		}
+	}
+
+	/// Liefert die Wortfolge einer Zelle
+	/** @param i Erste Position der Spanne
+	    @param j Position hinter der Spanne
+	    @return Wortfolge der Zelle
+	  */
+	BitWord* cell(const unsigned i, const unsigned j)
+	{
+		return &chart[(i*(length+1)+j)*words];
+	}
+
+	/// Prüft, ob ein Symbol in einer Zelle erkannt wurde
+	bool contains(const int s, const unsigned i, const unsigned j)
+	{
+		return (cell(i,j)[s/64] >> (s%64)) & 1;
+	}
+
+	/// Kombiniert zwei benachbarte Zellen über die binären Regeln
+	/** Für jedes Symbol B der linken Zelle wird seine Maske möglicher
+	  * rechter Nachbarn wortweise mit der rechten Zelle geschnitten; für
+	  * jeden Treffer C wird die Menge der Eltern von B C wortweise in die
+	  * Zielzelle vereinigt.
+	    @param left Linke Zelle
+	    @param right Rechte Zelle
+	    @param target Zielzelle
+	  */
+	void combine(const BitWord* left, const BitWord* right, BitWord* target)
+	{
+		for(unsigned w = 0; w < words; ++w)
+		{
+			for(BitWord bits = left[w]; bits != 0; bits &= bits-1)
+			{
+				int b = w*64+BitVector::lowest_bit(bits);
+				if(mask_of[b] == -1 ||
+				   !BitVector::and_into(&hits[0],right_masks[mask_of[b]].data(),
+				                        right,words))
+				{
+					continue;
+				}
+				for(unsigned v = 0; v < words; ++v)
+				{
+					for(BitWord cs = hits[v]; cs != 0; cs &= cs-1)
+					{
+						int c = v*64+BitVector::lowest_bit(cs);
+						unsigned index = binary_index.find(SymbolPair(b,c))->second;
+						BitVector::or_into(target,binary_parents[index].data(),
+						                   words);
+					}
+				}
+			}
+		}
+	}
+
+	/// Bildet den Abschluss einer Zelle unter den einstelligen Regeln
+	/** @param target Zelle
+	  */
+	void close_unary(BitWord* target)
+	{
+		for(unsigned w = 0; w < words; ++w)
+		{
+			for(BitWord bits = target[w]; bits != 0; bits &= bits-1)
+			{
+				agenda.push_back(w*64+BitVector::lowest_bit(bits));
+			}
+		}
+		while(!agenda.empty())
+		{
+			int b = agenda.back();
+			agenda.pop_back();
+			if(unary_of[b] == -1)
+			{
+				continue;
+			}
+			const BitWord* parents = unary_parents[unary_of[b]].data();
+			for(unsigned w = 0; w < words; ++w)
+			{
+				fresh[w] = parents[w] & ~target[w];
+				target[w] |= parents[w];
+			}
+			for(unsigned w = 0; w < words; ++w)
+			{
+				for(BitWord bits = fresh[w]; bits != 0; bits &= bits-1)
+				{
+					agenda.push_back(w*64+BitVector::lowest_bit(bits));
+				}
+			}
+		}
+	}
+
+	/// Trägt die Alternativen aller neuen Knoten ein
+	/** Arbeitet die Knoten ohne Alternativen mit einer expliziten Liste
+	  * statt rekursiv ab, damit lange Sätze den Aufrufstapel nicht
+	  * überlaufen lassen.
+	    @param forest Wald
+	  */
+	void build_forest(ParseForest& forest)
+	{
+		while(!tasks.empty())
+		{
+			const Task task = tasks.back();
+			tasks.pop_back();
+			if(task.dot > 0)
+			{
+				add_packings(forest,task.node,task.label,task.dot,task.begin,
+				             task.end);
+			}
+			else if(grammar.is_preterminal(task.label))
+			{
+				// Präterminal über genau einem Token
+				int leaf = forest.add_node(ParseForest::TERMINAL,
+				                           (*tokens)[task.begin],task.begin,
+				                           task.end);
+				forest.add_packing(task.node,-1,leaf);
+			}
+			else
+			{
+				for(CompiledGrammar::RuleId r = grammar.rules_begin(task.label);
+				    r != grammar.rules_end(task.label); ++r)
+				{
+					add_packings(forest,task.node,r,rules[r].rhs.size(),
+					             task.begin,task.end);
+				}
+			}
+		}
+	}
+
+	/// Liefert den Knoten eines Symbols über einer Spanne
+	/** Legt den Knoten beim ersten Aufruf im Wald an und merkt ihn vor,
+	  * damit build_forest() seine Alternativen über den ursprünglichen
+	  * Regeln einträgt. So führen auch Zyklen über einstellige Regeln auf
+	  * ihn zurück.
+	    @param forest Wald
+	    @param s Symbol der Grammatik
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	    @return Index des Knotens im Wald
+	  */
+	int symbol_node(ParseForest& forest, const int s, const unsigned begin,
+	                const unsigned end)
+	{
+		NodeKey key(std::make_pair(s,0u),std::make_pair(begin,end));
+		NodeMap::const_iterator n = nodes.find(key);
+		if(n != nodes.end())
+		{
+			return n->second;
+		}
+		int node = forest.add_node(ParseForest::SYMBOL,s,begin,end);
+		nodes[key] = node;
+		tasks.push_back(Task(node,s,0,begin,end));
+		return node;
+	}
+
+	/// Liefert den Knoten eines Regelpräfixes über einer Spanne
+	/** Präfixe der Länge 1 sind Symbolknoten, längere Zwischenknoten, die
+	  * sich Regeln mit gleichem Präfix teilen.
+	    @param forest Wald
+	    @param r Index der Regel
+	    @param dot Länge des Präfixes
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	    @return Index des Knotens im Wald
+	  */
+	int prefix_node(ParseForest& forest, const unsigned r, const unsigned dot,
+	                const unsigned begin, const unsigned end)
+	{
+		if(dot == 1)
+		{
+			return symbol_node(forest,rules[r].rhs[0],begin,end);
+		}
+
+		const int p = rules[r].prefixes[dot-1];
+		NodeKey key(std::make_pair(p,dot),std::make_pair(begin,end));
+		NodeMap::const_iterator n = nodes.find(key);
+		if(n != nodes.end())
+		{
+			return n->second;
+		}
+
+		int node = forest.add_node(ParseForest::INTERMEDIATE,p,begin,end);
+		nodes[key] = node;
+		tasks.push_back(Task(node,r,dot,begin,end));
+		return node;
+	}
+
+	/// Trägt die Alternativen eines Regelpräfixes in einen Knoten ein
+	/** Sucht alle Trennstellen, an denen das um ein Symbol kürzere Präfix
+	  * und das letzte Symbol im Chart stehen. Die künstlichen Symbole der
+	  * Binarisierung schließen dabei Sackgassen von vornherein aus.
+	    @param forest Wald
+	    @param node Index des Knotens
+	    @param r Index der Regel
+	    @param dot Länge des Präfixes
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	  */
+	void add_packings(ParseForest& forest, const int node, const unsigned r,
+	                  const unsigned dot, const unsigned begin,
+	                  const unsigned end)
+	{
+		const Rule& rule = rules[r];
+		const int last = rule.rhs[dot-1];
+		if(dot == 1)
+		{
+			if(contains(last,begin,end))
+			{
+				forest.add_packing(node,-1,symbol_node(forest,last,begin,end));
+			}
+			return;
+		}
+		for(unsigned k = begin+1; k < end; ++k)
+		{
+			if(contains(rule.prefixes[dot-2],begin,k) && contains(last,k,end))
+			{
+				int prefix = prefix_node(forest,r,dot-1,begin,k);
+				forest.add_packing(node,prefix,symbol_node(forest,last,k,end));
+			}
+		}
+	}
+};
+
+#endif
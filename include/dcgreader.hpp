@@ -21,11 +21,14 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <set>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <new>
 #include "globaltypes.hpp"
 
@@ -33,6 +36,12 @@
 /** Endlicher Automat, der entweder die Produktionsregeln oder das Lexikon
   * einer separierten Grammatik im Prolog-DCG-Format akzeptiert, und Regel
   * für Regel zur Weiterverarbeitung ausgibt.
+  *
+  * Die Übergänge werden lesbar als Maps beschrieben und danach in dichte
+  * Tabellen übersetzt: eine Zeichenklasse pro Byte, ein Folgezustand pro
+  * Zustand und Zeichenklasse und Aktionsbits pro Zustand. Läufe gleicher
+  * Zeichen, bei denen der Automat im selben Zustand bleibt (Whitespace,
+  * Bezeichner, Tokens), werden am Stück übersprungen bzw. angehängt.
   */
 class DCGReader
 {
@@ -57,6 +66,13 @@ class DCGReader
 	/// Menge von Zuständen
 	typedef std::set<State> StateSet;
 
+	/// Anzahl der Zeichenklassen
+	enum {CLASSES = INVALID+1};
+
+	/// Aktionsbits eines Zustands in der übersetzten Tabelle
+	enum Action {ACT_STOP = 1, ACT_LHS_CHAR = 2, ACT_RHS_CHAR = 4,
+	             ACT_RHS_CHAR_ESC = 8, ACT_NEXT_RHS_SYMBOL = 16};
+
 	public:
 
 	////////////////////////////////////////////////////////////////////////////
@@ -72,6 +88,7 @@ class DCGReader
 		lexicon = false;
 		init_filestream(prologfile);
 		init_grammar_reader();
+		compile_automaton();
 	}
 
 	/// Konstruktor eines Automaten zum Lesen von Lexikon oder Grammatik
@@ -92,15 +109,78 @@ class DCGReader
 		{
 			init_grammar_reader();
 		}
+		compile_automaton();
+	}
+
+	/// Konstruktor eines Automaten für einen Abschnitt eines Textes
+	/** Liest nur den Abschnitt, etwa ein Stück einer großen Datei, das ein
+	  * eigener Thread einliest. Der Abschnitt muss an einer Regelgrenze
+	  * beginnen und enden und wird nicht kopiert. Bei einem Fehler bricht
+	  * der Automat nicht das Programm ab, sondern hält an und merkt sich
+	  * die Fehlermeldung.
+	    @param prologfile Dateiname der DCG für Fehlermeldungen
+	    @param begin Erstes Zeichen des Abschnitts
+	    @param end Zeichen hinter dem Abschnitt
+	    @param make_lexicon_reader Für Lexikon initialisieren ja/nein
+	    @param line Zeilennummer des ersten Zeichens in der Datei
+	    @param column Spaltennummer des ersten Zeichens in der Datei
+	  */
+	DCGReader(const std::string prologfile, const char* begin,
+	          const char* end, const bool make_lexicon_reader,
+	          const unsigned line, const unsigned column)
+	{
+		lexicon = make_lexicon_reader;
+		quiet = true;
+		filename = prologfile;
+		buffer = begin;
+		length = end - begin;
+		curr_char = begin;
+		linecount = line;
+		colcount = column;
+		if(make_lexicon_reader)
+		{
+			init_lexicon_reader();
+		}
+		else
+		{
+			init_grammar_reader();
+		}
+		compile_automaton();
 	}
 
-	/// Destruktor
-	/** Gibt den verwendeten Speicherplatz im Heap wieder frei.
+	/// Liest eine Datei vollständig ein
+	/** @param prologfile Dateiname
+	    @param text Inhalt der Datei
+	    @param error Fehlermeldung, falls die Datei nicht geöffnet werden kann
+	    @return Datei gelesen ja/nein
 	  */
-	~DCGReader()
+	static bool read_file(const std::string prologfile, std::string& text,
+	                      std::string& error)
 	{
-		// Buffer löschen
-		delete[] buffer;
+		// Erzeuge einen Input-Filestream aus der Datei
+		std::ifstream dcg_stream(prologfile.c_str());
+		if(dcg_stream)
+		{
+			// Ermittle Länge der Datei
+			dcg_stream.seekg(0,dcg_stream.end);
+			const std::streamoff length = dcg_stream.tellg();
+			dcg_stream.seekg(0,dcg_stream.beg);
+
+			// Lies die Datei ein
+			text.resize(length);
+			if(length > 0)
+			{
+				dcg_stream.read(&text[0],length);
+				text.resize(dcg_stream.gcount());
+			}
+		}
+		else
+		{
+			// Stream fehlgeschlagen, Fehlermeldung
+			error = "Datei '"+prologfile+"' konnte nicht geoeffnet werden.\n";
+			return false;
+		}
+		return true;
 	}
 
 	/// Lässt den Grammatik-Automaten auf einer Zeichenkette laufen
@@ -139,34 +219,39 @@ class DCGReader
 		State q = start;
 
 		// Schleife über die Zustände
-		while(stop.find(q) == stop.end())
+		while(!(actions[q] & ACT_STOP))
 		{
 			// Überspringe Prolog-Kommentare
 			skip_comment();
 
 			// Suche Übergang mit aktuellem Zeichen
-			q = search_transition(q);
+			const CharType c_type = current_type();
+			q = search_transition(q,c_type);
+
+			// Lauf gleicher Zeichen, über den der Automat im Zustand bleibt
+			const char* run_end = scan_run(q,c_type);
 
 			// In einigen Zuständen besondere Behandlung des Inputs
-			if(lhs_char.find(q) != lhs_char.end())
+			const unsigned char action = actions[q];
+			if(action & ACT_LHS_CHAR)
 			{
 				// Verkette Zeichen zum Symbol der linken Regelseite
-				lhs += *curr_char;
+				lhs.append(curr_char,run_end);
 			}
-			else if(rhs_char.find(q) != rhs_char.end())
+			else if(action & ACT_RHS_CHAR)
 			{
 				// Verkette Zeichen zu einem Symbol der rechten Regelseite
-				*rhs_pos += *curr_char;
+				rhs_pos->append(curr_char,run_end);
 			}
-			else if(next_rhs_symbol.find(q) != next_rhs_symbol.end())
+			else if(action & ACT_NEXT_RHS_SYMBOL)
 			{
 				// Beginne ein weiteres Symbol der rechten Regelseite
 				rhs.push_back(std::string(""));
 				++rhs_pos;
 			}
 
-			// Rücke ein Zeichen weiter
-			next_char();
+			// Rücke hinter den Lauf weiter
+			advance(run_end);
 		}
 
 		// Gib die gelesene Regel aus
@@ -207,34 +292,39 @@ class DCGReader
 		State q = start;
 
 		// Schleife über die Zustände
-		while(stop.find(q) == stop.end())
+		while(!(actions[q] & ACT_STOP))
 		{
 			// Überspringe Prolog-Kommentare
 			skip_comment();
 
 			// Suche Übergang mit aktuellem Zeichen
-			q = search_transition(q);
+			const CharType c_type = current_type();
+			q = search_transition(q,c_type);
+
+			// Lauf gleicher Zeichen, über den der Automat im Zustand bleibt
+			const char* run_end = scan_run(q,c_type);
 
 			// In einigen Zuständen besondere Behandlung des Inputs
-			if(lhs_char.find(q) != lhs_char.end())
+			const unsigned char action = actions[q];
+			if(action & ACT_LHS_CHAR)
 			{
 				// Verkette Zeichen zum Symbol
-				sym += *curr_char;
+				sym.append(curr_char,run_end);
 			}
-			else if(rhs_char.find(q) != rhs_char.end())
+			else if(action & ACT_RHS_CHAR)
 			{
 				// Verkette Zeichen zum Token
-				tok += *curr_char;
+				tok.append(curr_char,run_end);
 			}
-			else if(rhs_char_esc.find(q) != rhs_char_esc.end())
+			else if(action & ACT_RHS_CHAR_ESC)
 			{
 				// Entferne Escape-Zeichen und verkette Zeichen zum Token
 				tok.erase(--tok.end());
 				tok += *curr_char;
 			}
 
-			// Rücke ein Zeichen weiter
-			next_char();
+			// Rücke hinter den Lauf weiter
+			advance(run_end);
 		}
 
 		// Gib die gelesene Regel aus
@@ -251,6 +341,18 @@ class DCGReader
 		return curr_char >= buffer + length;
 	}
 
+	/// Gibt aus, ob ein Automat für einen Abschnitt einen Fehler gefunden hat
+	bool failed() const
+	{
+		return !error_message.empty();
+	}
+
+	/// Liefert die Fehlermeldung eines Automaten für einen Abschnitt
+	const std::string& error() const
+	{
+		return error_message;
+	}
+
 	private:
 
 	////////////////////////////////////////////////////////////////////////////
@@ -258,8 +360,11 @@ class DCGReader
 
 	bool lexicon;				///< Instanz ist Lexikon-Reader, ja/nein
 	std::string filename;		///< Dateiname der eingelesenen Prolog-Datei
+	bool quiet;					///< Fehler merken statt abbrechen, ja/nein
+	std::string error_message;	///< Gemerkter Fehler oder leer
 	unsigned length;			///< Länge der Datei in Zeichen
-	char* buffer;				///< Buffer, in den die Datei eingelesen wird
+	std::string contents;		///< Eingelesene Datei, falls selbst gelesen
+	const char* buffer;			///< Erstes Zeichen des Inputs
 	const char* curr_char;		///< Zeichen, bei dem der Automat aktuell steht
 	unsigned linecount;			///< Zeilennummer des aktuellen Zeichens
 	unsigned colcount;			///< Spaltennummer des aktuellen Zeichens
@@ -272,6 +377,10 @@ class DCGReader
 	StateSet rhs_char_esc;		///< Zustände mit escaptem Zeichen der RHS
 	StateSet next_rhs_symbol;	///< Zustände mit einem weiteren RHS-Symbol
 
+	CharType byte_class[256];			///< Byte -> Zeichenklasse
+	std::vector<State> table;			///< Zustand*CLASSES+Klasse -> Zustand
+	std::vector<unsigned char> actions;	///< Zustand -> Aktionsbits
+
 	////////////////////////////////////////////////////////////////////////////
 	// Private Funktionen
 
@@ -284,40 +393,23 @@ class DCGReader
 	{
 		// Speichere Dateinamen intern für Fehlermeldungen
 		filename = prologfile;
+		quiet = false;
 
-		// Erzeuge einen Input-Filestream aus der Datei
-		std::ifstream dcg_stream(prologfile.c_str());
-		if(dcg_stream)
+		// Lies die Datei ein, c_str() endet mit einem Nullbyte als Endmarke
+		std::string error;
+		if(!read_file(prologfile,contents,error))
 		{
-			// Ermittle Länge der Datei
-			dcg_stream.seekg(0,dcg_stream.end);
-			length = dcg_stream.tellg();
-			dcg_stream.seekg(0,dcg_stream.beg);
-
-			// Stelle einen Buffer entsprechender Länge bereit
-			buffer = new (std::nothrow) char[length+1];
-			if(buffer == 0)
-			{
-				std::cerr << "Speicherfehler. Datei '" << prologfile
-				          << "' konnte nicht eingelesen werden.\n";
-				exit(1);
-			}
-
-			// Lies die Datei ein
-			dcg_stream.read(buffer,length);
-
-			// Aktuelles Zeichen ist das erste Zeichen der Datei
-			curr_char = buffer;
-			linecount = 1;
-			colcount = 1;
-		}
-		else
-		{
-			// Stream fehlgeschlagen, Fehlermeldung und Abbruch
-			std::cerr << "Datei '" << prologfile
-			          << "' konnte nicht geoeffnet werden.\n";
+			// Fehlermeldung und Abbruch
+			std::cerr << error;
 			exit(1);
 		}
+		buffer = contents.c_str();
+		length = contents.size();
+
+		// Aktuelles Zeichen ist das erste Zeichen der Datei
+		curr_char = buffer;
+		linecount = 1;
+		colcount = 1;
 	}
 
 	/// Initialisiert den Automaten zum Lesen einer Grammatik
@@ -524,17 +616,63 @@ class DCGReader
 		stop.insert(14);
 	}
 
+	/// Übersetzt die beschriebenen Übergänge in dichte Tabellen
+	/** Trägt für jedes Byte seine Zeichenklasse, für jeden Zustand und
+	  * jede Zeichenklasse den Folgezustand (-1 für keinen) und für jeden
+	  * Zustand seine Aktionsbits in flache Felder ein.
+	  */
+	void compile_automaton()
+	{
+		for(unsigned b = 0; b < 256; ++b)
+		{
+			byte_class[b] = classify(static_cast<char>(b));
+		}
+
+		State states = 0;
+		for(DeltaMap::const_iterator d = delta.begin(); d != delta.end(); ++d)
+		{
+			states = std::max(states,d->first+1);
+		}
+		states = std::max(states,*stop.rbegin()+1);
+
+		table.assign(states*CLASSES,-1);
+		for(DeltaMap::const_iterator d = delta.begin(); d != delta.end(); ++d)
+		{
+			for(Transitions::const_iterator t = d->second.begin();
+			    t != d->second.end(); ++t)
+			{
+				table[d->first*CLASSES+t->first] = t->second;
+			}
+		}
+
+		actions.assign(states,0);
+		mark(stop,ACT_STOP);
+		mark(lhs_char,ACT_LHS_CHAR);
+		mark(rhs_char,ACT_RHS_CHAR);
+		mark(rhs_char_esc,ACT_RHS_CHAR_ESC);
+		mark(next_rhs_symbol,ACT_NEXT_RHS_SYMBOL);
+	}
+
+	/// Setzt ein Aktionsbit für eine Menge von Zuständen
+	void mark(const StateSet& states, const Action action)
+	{
+		for(StateSet::const_iterator q = states.begin(); q != states.end(); ++q)
+		{
+			actions[*q] |= action;
+		}
+	}
+
 	/// Liefert zu einem Zeichen die interne Zeichenklasse
 	/** Ordnet ein Zeichen der DCG einer der internen Zeichenklassen zu.
+	  * Wird nur beim Aufbau der Bytetabelle aufgerufen.
 	    @param c Zeichen
 	    @return Zeichenklasse
 	  */
-	CharType classify(const char c) const
+	static CharType classify(const char c)
 	{
 		CharType c_type = INVALID;
 
-		if(finished())		c_type = END;
-		else if(isalpha(c))	c_type = ALPHA;
+		if(isalpha(c))		c_type = ALPHA;
 		else if(isspace(c))	c_type = SPACE;
 		else if(c == '-')	c_type = HYPHEN;
 		else if(c == '>')	c_type = GREATER;
@@ -547,18 +685,28 @@ class DCGReader
 		return c_type;
 	}
 
+	/// Liefert die Zeichenklasse des aktuellen Zeichens
+	CharType current_type() const
+	{
+		if(finished())
+		{
+			return END;
+		}
+		return byte_class[static_cast<unsigned char>(*curr_char)];
+	}
+
 	/// Überspringt einen Prolog-Kommentar
 	/** Prüft, ob das aktuelle Zeichen der DCG einen Kommentar markiert.
 	  * Überspringt diesen im positiven Falle bis zum folgenden Zeilenumbruch.
 	  */
 	void skip_comment()
 	{
-		if(*curr_char == '%')
+		if(!finished() && *curr_char == '%')
 		{
-			while(*curr_char != '\n')
-			{
-				++curr_char;
-			}
+			const char* end = buffer + length;
+			const char* newline = static_cast<const char*>(
+				std::memchr(curr_char,'\n',end-curr_char));
+			advance(newline != 0 ? newline : end);
 			// Aktuelles Zeichen ist jetzt beabsichtigterweise
 			// der Zeilenumbruch: Kommentare erlaubt Prolog nur dort,
 			// wo auch Whitespace stehen darf
@@ -570,65 +718,106 @@ class DCGReader
 	  * und gibt den so erreichten Zustand aus. Bei nicht gefundenem Übergang
 	  * Abbruch wegen unerwartetem Zeichen in der DCG.
 	    @param q Zustand vorher
+	    @param c_type Zeichenklasse des aktuellen Zeichens
 	    @return Zustand nachher
 	  */
-	State search_transition(State q)
+	State search_transition(const State q, const CharType c_type)
 	{
 		// Suche Übergang mit aktuellem Zeichen
-		CharType c_type = classify(*curr_char);
-		Transitions& trans = delta[q];
-		Transitions::const_iterator t = trans.find(c_type);
-		if(t != trans.end())
+		const State next = table[q*CLASSES+c_type];
+		if(next != -1)
 		{
 			// Gib den gefundenen Übergang aus
-			return t->second;
+			return next;
 		}
 		else
 		{
 			// Kein Übergang gefunden: unerwartetes Zeichen
 
-			// Gib eine Fehlermeldung aus
-			std::cerr << "Einlesen der Datei '" << filename
-					  << "' fehlgeschlagen: ";
+			// Baue eine Fehlermeldung auf
+			std::ostringstream message;
+			message << "Einlesen der Datei '" << filename
+			        << "' fehlgeschlagen: ";
 			if(*curr_char == '\0')
 			{
-				std::cerr << "unerwartetes Dateiende.\n";
-				std::cerr << "Zustand " << q << ", Zeile " << linecount
-						  << ", Zeichen " << colcount << ".\n";
+				message << "unerwartetes Dateiende.\n";
+				message << "Zustand " << q << ", Zeile " << linecount
+				        << ", Zeichen " << colcount << ".\n";
 			}
 			else if(*curr_char == '\n')
 			{
-				std::cerr << "unerwarteter Zeilenumbruch, Zeile "
-						  << linecount << ".\n";
+				message << "unerwarteter Zeilenumbruch, Zeile "
+				        << linecount << ".\n";
 			}
 			else
 			{
-				std::cerr << "unerwartetes Zeichen '" << *curr_char
-						  << "', Zeile " << linecount
-						  << ", Zeichen " << colcount << ".\n";
+				message << "unerwartetes Zeichen '" << *curr_char
+				        << "', Zeile " << linecount
+				        << ", Zeichen " << colcount << ".\n";
+			}
+
+			if(quiet)
+			{
+				// Fehler merken und den Automaten am Ende anhalten
+				error_message = message.str();
+				curr_char = buffer + length;
+				return *stop.begin();
 			}
 
-			// Abbruch
+			// Fehlermeldung ausgeben und abbrechen
+			std::cerr << message.str();
 			exit(1);
 		}
 	}
 
-	/// Rückt im Input ein Zeichen vor
-	/** Rückt im Input ein Zeichen weiter und aktualisiert Zeilen- und
-	  * Spaltennummer.
+	/// Findet das Ende eines Laufs gleicher Zeichen
+	/** Der Automat ist mit dem aktuellen Zeichen in einen Zustand gelangt.
+	  * Führt dieser Zustand mit derselben Zeichenklasse auf sich selbst,
+	  * gehören alle folgenden Zeichen dieser Klasse zum selben Lauf, bis auf
+	  * ein Kommentarzeichen, das immer einzeln betrachtet wird.
+	    @param q Erreichter Zustand
+	    @param c_type Zeichenklasse des aktuellen Zeichens
+	    @return Zeiger hinter das letzte Zeichen des Laufs
 	  */
-	void next_char()
+	const char* scan_run(const State q, const CharType c_type) const
 	{
-		if(*curr_char == '\n')
+		const char* pos = curr_char + 1;
+		if(c_type == END || table[q*CLASSES+c_type] != q)
 		{
-			++linecount;
-			colcount = 1;
+			return pos;
 		}
-		else
+		const char* end = buffer + length;
+		while(pos < end && *pos != '%' &&
+		      byte_class[static_cast<unsigned char>(*pos)] == c_type)
+		{
+			++pos;
+		}
+		return pos;
+	}
+
+	/// Rückt im Input bis zu einer Position vor
+	/** Rückt im Input bis vor ein Zeichen weiter und aktualisiert Zeilen-
+	  * und Spaltennummer anhand der übersprungenen Zeilenumbrüche.
+	    @param end Neue aktuelle Position
+	  */
+	void advance(const char* end)
+	{
+		const char* limit = std::min(end,static_cast<const char*>(buffer+length));
+		const char* line = curr_char;
+		while(line < limit)
 		{
-			++colcount;
+			const char* newline = static_cast<const char*>(
+				std::memchr(line,'\n',limit-line));
+			if(newline == 0)
+			{
+				break;
+			}
+			++linecount;
+			colcount = 1;
+			line = newline + 1;
 		}
-		++curr_char;
+		colcount += end - line;
+		curr_char = end;
 	}
 };
 
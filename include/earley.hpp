@@ -0,0 +1,483 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// earley.hpp
+// Klasse EarleyParser implementiert einen Chart-Parser nach Earley
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_EARLEY_HPP__
+#define __WEGEL_TDBP_EARLEY_HPP__
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/functional/hash.hpp>
+#include "globaltypes.hpp"
+#include "compiledgrammar.hpp"
+#include "forest.hpp"
+
+/// Chart-Parser nach Earley
+/** Erkennt einen Satz auf Grundlage derselben separierten Grammatik wie der
+  * Top-Down-Backtracking-Parser in höchstens kubischer Zeit und baut daraus
+  * einen gepackten Parsewald auf. Da die Grammatik keine leeren Regeln
+  * enthält, entfällt die Sonderbehandlung leerer Ableitungen.
+  */
+class EarleyParser
+{
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Produktionsregel
+	/** Die rechte Seite verweist in die flachen Felder der Grammatik.
+	  */
+	struct Rule
+	{
+		SymbolId		lhs;	///< Symbol der linken Regelseite
+		const SymbolId*	rhs;	///< Symbole der rechten Regelseite
+		unsigned		length;	///< Länge der rechten Regelseite
+	};
+
+	/// Earley-Item: Regel, Position des Punktes, Startposition
+	struct Item
+	{
+		unsigned	rule;	///< Index der Regel
+		unsigned	dot;	///< Anzahl bereits erkannter Symbole der RHS
+		unsigned	origin;	///< Input-Position, an der die Regel beginnt
+
+		/// Konstruktor aus Regel, Punkt und Startposition
+		Item(unsigned r, unsigned d, unsigned o)
+		{
+			rule = r;
+			dot = d;
+			origin = o;
+		}
+
+		/// Gleichheits-Operator
+		bool operator==(const Item& rhs) const
+		{
+			return rule == rhs.rule && dot == rhs.dot && origin == rhs.origin;
+		}
+
+		/// Hashfunktion für boost::unordered_set
+		friend std::size_t hash_value(const Item& i)
+		{
+			std::size_t seed = 0;
+			boost::hash_combine(seed,i.rule);
+			boost::hash_combine(seed,i.dot);
+			boost::hash_combine(seed,i.origin);
+			return seed;
+		}
+	};
+
+	/// Fertig erkanntes Symbol als Paar Symbol, Startposition
+	typedef std::pair<SymbolId,unsigned> Completed;
+
+	/// Menge von Items an einer Input-Position
+	struct ItemSet
+	{
+		std::vector<Item> items;				///< Items in Reihenfolge
+		boost::unordered_set<Item> index;		///< Items zum Nachschlagen
+		boost::unordered_set<Completed> done;	///< Fertig erkannte Symbole
+		/// Symbol -> Startpositionen, an denen es fertig erkannt hier endet
+		boost::unordered_map<SymbolId,std::vector<unsigned> > origins;
+		/// Symbol -> Items, die auf das Symbol warten
+		boost::unordered_map<SymbolId,std::vector<unsigned> > waiting;
+		std::vector<bool> predicted;			///< Bereits vorhergesagte Symbole
+	};
+
+	/// Schlüssel eines Knotens im Wald: Symbol oder Regel, Punkt, Spanne
+	typedef std::pair<std::pair<long,unsigned>,std::pair<unsigned,unsigned> >
+		NodeKey;
+
+	/// Map Schlüssel -> Index des Knotens im Wald
+	typedef boost::unordered_map<NodeKey,int> NodeMap;
+
+	/// Knoten des Waldes, dessen Alternativen noch fehlen
+	struct Task
+	{
+		int			node;	///< Index des Knotens im Wald
+		unsigned	label;	///< Symbol oder Regel des Knotens
+		unsigned	dot;	///< Länge des Regelpräfixes, 0 bei Symbolknoten
+		unsigned	begin;	///< Erste Position der Spanne
+		unsigned	end;	///< Position hinter der Spanne
+
+		/// Konstruktor aus Knoten, Symbol oder Regel, Präfixlänge und Spanne
+		Task(int n, unsigned l, unsigned d, unsigned b, unsigned e)
+		{
+			node = n;
+			label = l;
+			dot = d;
+			begin = b;
+			end = e;
+		}
+	};
+
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor aus einer übersetzten Grammatik
+	/** Legt die Regeln mit einer künstlichen Startregel -> s an. Regel r+1
+	  * entspricht Regel r der Grammatik, sodass die Regeln eines Symbols
+	  * wie dort einen zusammenhängenden Abschnitt bilden.
+	    @param g Übersetzte Grammatik
+	  */
+	EarleyParser(const CompiledGrammar& g) : grammar(g)
+	{
+		// Das künstliche Startsymbol folgt auf alle Symbole der Grammatik
+		start_symbol = grammar.start();
+		Rule start_rule;
+		start_rule.lhs = grammar.symbol_count();
+		start_rule.rhs = &start_symbol;
+		start_rule.length = 1;
+		rules.push_back(start_rule);
+
+		// Übernimm die Produktionsregeln
+		for(SymbolId s = 0; s < grammar.symbol_count(); ++s)
+		{
+			for(CompiledGrammar::RuleId r = grammar.rules_begin(s);
+			    r != grammar.rules_end(s); ++r)
+			{
+				Rule rule;
+				rule.lhs = s;
+				rule.rhs = grammar.rhs_begin(r);
+				rule.length = grammar.rhs_length(r);
+				rules.push_back(rule);
+			}
+		}
+	}
+
+	/// Parst einen tokenisierten Satz
+	/** Erkennt den Satz mit dem Earley-Algorithmus und baut bei Erfolg
+	  * einen gepackten Parsewald auf.
+	    @param input Tokenindizes des Inputs
+	    @param forest Wald, in den die Bäume eingetragen werden
+	  */
+	void parse(const TokenIdList& input, ParseForest& forest)
+	{
+		init_parse(input);
+
+		// Beginne mit dem künstlichen Startsymbol
+		add(0,Item(0,0,0));
+		for(unsigned k = 0; k < sets.size(); ++k)
+		{
+			// Die Menge wächst während des Durchlaufs
+			for(unsigned i = 0; i < sets[k].items.size(); ++i)
+			{
+				process(k,i);
+			}
+		}
+
+		// Baue den Wald auf, falls das Startsymbol den Input überspannt
+		if(sets[length].index.count(Item(0,1,0)) > 0)
+		{
+			nodes.clear();
+			forest.set_root(symbol_node(forest,grammar.start(),0,length));
+			build_forest(forest);
+		}
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	const CompiledGrammar& grammar;	///< Übersetzte Grammatik
+	SymbolId start_symbol;			///< Rechte Seite der Startregel
+	std::vector<Rule> rules;		///< Produktionsregeln, Regel 0 ist Start
+
+	const TokenIdList* tokens;		///< Input-Tokens
+	unsigned length;				///< Anzahl der Input-Tokens
+	std::vector<ItemSet> sets;		///< Item-Mengen pro Input-Position
+	NodeMap nodes;					///< Bereits angelegte Knoten des Waldes
+	std::vector<Task> tasks;		///< Knoten ohne Alternativen
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Initialisiert Daten für Durchlauf des Parsers
+	/** Legt leere Item-Mengen an.
+	    @param input Tokenindizes des Inputs
+	  */
+	void init_parse(const TokenIdList& input)
+	{
+		tokens = &input;
+		length = input.size();
+		sets.assign(length+1,ItemSet());
+		for(unsigned k = 0; k <= length; ++k)
+		{
+			sets[k].predicted.assign(grammar.symbol_count()+1,false);
+		}
+	}
+
+	/// Liefert die erste Regel eines Symbols
+	unsigned rules_begin(const SymbolId s) const
+	{
+		return s == grammar.symbol_count() ? 0 : grammar.rules_begin(s)+1;
+	}
+
+	/// Liefert die Regel hinter der letzten Regel eines Symbols
+	unsigned rules_end(const SymbolId s) const
+	{
+		return s == grammar.symbol_count() ? 1 : grammar.rules_end(s)+1;
+	}
+
+	/// Fügt einer Item-Menge ein Item hinzu, falls es noch fehlt
+	/** @param k Input-Position der Menge
+	    @param item Item
+	  */
+	void add(const unsigned k, const Item& item)
+	{
+		if(sets[k].index.insert(item).second)
+		{
+			sets[k].items.push_back(item);
+		}
+	}
+
+	/// Prüft, ob ein Präterminal ein Token des Inputs abdeckt
+	/** @param s Symbol
+	    @param k Input-Position des Tokens
+	    @return Lexikonregel vorhanden ja/nein
+	  */
+	bool scans(const SymbolId s, const unsigned k) const
+	{
+		return k < length && grammar.has_category((*tokens)[k],s);
+	}
+
+	/// Verarbeitet ein Item: Vorhersage, Scannen oder Vervollständigen
+	/** @param k Input-Position der Item-Menge
+	    @param i Index des Items in der Menge
+	  */
+	void process(const unsigned k, const unsigned i)
+	{
+		const Item item = sets[k].items[i];
+		const Rule& rule = rules[item.rule];
+
+		if(item.dot == rule.length)
+		{
+			// Vervollständigen: Rücke alle Items weiter, die auf das Symbol
+			// der linken Regelseite warten
+			if(sets[k].done.insert(Completed(rule.lhs,item.origin)).second)
+			{
+				sets[k].origins[rule.lhs].push_back(item.origin);
+			}
+			const ItemSet& origin = sets[item.origin];
+			boost::unordered_map<SymbolId,std::vector<unsigned> >::const_iterator w =
+				origin.waiting.find(rule.lhs);
+			if(w != origin.waiting.end())
+			{
+				for(std::vector<unsigned>::const_iterator j = w->second.begin();
+				    j != w->second.end(); ++j)
+				{
+					const Item& waiting = origin.items[*j];
+					add(k,Item(waiting.rule,waiting.dot+1,waiting.origin));
+				}
+			}
+		}
+		else
+		{
+			const SymbolId next = rule.rhs[item.dot];
+			if(grammar.is_preterminal(next))
+			{
+				// Scannen: Präterminal mit dem nächsten Token vergleichen
+				if(scans(next,k))
+				{
+					add(k+1,Item(item.rule,item.dot+1,item.origin));
+				}
+			}
+			else
+			{
+				// Vorhersage: Merke das wartende Item und lege die Regeln
+				// des Symbols einmal pro Position an
+				sets[k].waiting[next].push_back(i);
+				if(!sets[k].predicted[next])
+				{
+					sets[k].predicted[next] = true;
+					for(unsigned r = rules_begin(next); r != rules_end(next); ++r)
+					{
+						add(k,Item(r,0,k));
+					}
+				}
+			}
+		}
+	}
+
+	/// Trägt die Alternativen aller neuen Knoten ein
+	/** Arbeitet die Knoten ohne Alternativen mit einer expliziten Liste
+	  * statt rekursiv ab, denn die Tiefe des Waldes wächst mit der
+	  * Satzlänge.
+	    @param forest Wald
+	  */
+	void build_forest(ParseForest& forest)
+	{
+		while(!tasks.empty())
+		{
+			const Task task = tasks.back();
+			tasks.pop_back();
+			if(task.dot > 0)
+			{
+				add_packings(forest,task.node,task.label,task.dot,task.begin,
+				             task.end);
+			}
+			else if(grammar.is_preterminal(task.label))
+			{
+				// Präterminal über genau einem Token
+				int leaf = forest.add_node(ParseForest::TERMINAL,
+				                           (*tokens)[task.begin],task.begin,
+				                           task.end);
+				forest.add_packing(task.node,-1,leaf);
+			}
+			else
+			{
+				// Alle Regeln des Symbols, die die Spanne abdecken
+				for(unsigned r = rules_begin(task.label);
+				    r != rules_end(task.label); ++r)
+				{
+					unsigned dot = rules[r].length;
+					if(sets[task.end].index.count(Item(r,dot,task.begin)) > 0)
+					{
+						add_packings(forest,task.node,r,dot,task.begin,
+						             task.end);
+					}
+				}
+			}
+		}
+	}
+
+	/// Liefert den Knoten eines Symbols über einer Spanne
+	/** Legt den Knoten beim ersten Aufruf im Wald an und merkt ihn vor,
+	  * damit build_forest() seine Alternativen einträgt. So führen auch
+	  * Zyklen über einstellige Regeln auf ihn zurück.
+	    @param forest Wald
+	    @param s Symbol
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	    @return Index des Knotens im Wald
+	  */
+	int symbol_node(ParseForest& forest, const SymbolId s, const unsigned begin,
+	                const unsigned end)
+	{
+		NodeKey key(std::make_pair(long(s),0u),std::make_pair(begin,end));
+		NodeMap::const_iterator n = nodes.find(key);
+		if(n != nodes.end())
+		{
+			return n->second;
+		}
+		int node = forest.add_node(ParseForest::SYMBOL,s,begin,end);
+		nodes[key] = node;
+		tasks.push_back(Task(node,s,0,begin,end));
+		return node;
+	}
+
+	/// Liefert den Zwischenknoten eines Regelpräfixes über einer Spanne
+	/** Legt den Knoten beim ersten Aufruf an und merkt ihn wie
+	  * symbol_node() vor.
+	    @param forest Wald
+	    @param r Index der Regel
+	    @param dot Länge des Präfixes
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	    @return Index des Knotens im Wald
+	  */
+	int intermediate_node(ParseForest& forest, const unsigned r,
+	                      const unsigned dot, const unsigned begin,
+	                      const unsigned end)
+	{
+		NodeKey key(std::make_pair(-1-long(r),dot),std::make_pair(begin,end));
+		NodeMap::const_iterator n = nodes.find(key);
+		if(n != nodes.end())
+		{
+			return n->second;
+		}
+		int node = forest.add_node(ParseForest::INTERMEDIATE,r,begin,end);
+		nodes[key] = node;
+		tasks.push_back(Task(node,r,dot,begin,end));
+		return node;
+	}
+
+	/// Trägt die Alternativen eines Regelpräfixes in einen Knoten ein
+	/** Sucht alle Trennstellen zwischen dem Präfix ohne letztes Symbol und
+	  * dem letzten Symbol, die beide im Chart erkannt wurden. Als
+	  * Trennstellen kommen nur die Startpositionen in Frage, an denen das
+	  * letzte Symbol fertig erkannt am Ende der Spanne endet.
+	    @param forest Wald
+	    @param node Index des Knotens
+	    @param r Index der Regel
+	    @param dot Länge des Präfixes
+	    @param begin Erste Position der Spanne
+	    @param end Position hinter der Spanne
+	  */
+	void add_packings(ParseForest& forest, const int node, const unsigned r,
+	                  const unsigned dot, const unsigned begin,
+	                  const unsigned end)
+	{
+		const SymbolId* rhs = rules[r].rhs;
+		const SymbolId last = rhs[dot-1];
+		if(dot == 1)
+		{
+			forest.add_packing(node,-1,symbol_node(forest,last,begin,end));
+			return;
+		}
+		if(grammar.is_preterminal(last))
+		{
+			// Ein Präterminal deckt genau das letzte Token ab
+			if(end > begin+1 && scans(last,end-1))
+			{
+				add_split(forest,node,r,dot,begin,end-1,end);
+			}
+			return;
+		}
+		boost::unordered_map<SymbolId,std::vector<unsigned> >::const_iterator o =
+			sets[end].origins.find(last);
+		if(o == sets[end].origins.end())
+		{
+			return;
+		}
+		for(std::vector<unsigned>::const_iterator k = o->second.begin();
+		    k != o->second.end(); ++k)
+		{
+			if(*k > begin && *k < end)
+			{
+				add_split(forest,node,r,dot,begin,*k,end);
+			}
+		}
+	}
+
+	/// Trägt eine Trennstelle ein, falls dort das Präfix erkannt wurde
+	/** @param forest Wald
+	    @param node Index des Knotens
+	    @param r Index der Regel
+	    @param dot Länge des Präfixes
+	    @param begin Erste Position der Spanne
+	    @param k Trennstelle vor dem letzten Symbol
+	    @param end Position hinter der Spanne
+	  */
+	void add_split(ParseForest& forest, const int node, const unsigned r,
+	               const unsigned dot, const unsigned begin, const unsigned k,
+	               const unsigned end)
+	{
+		if(sets[k].index.count(Item(r,dot-1,begin)) > 0)
+		{
+			const SymbolId* rhs = rules[r].rhs;
+			int prefix = dot == 2 ? symbol_node(forest,rhs[0],begin,k)
+			                      : intermediate_node(forest,r,dot-1,begin,k);
+			forest.add_packing(node,prefix,symbol_node(forest,rhs[dot-1],k,end));
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// fingerprint.hpp
+// Klasse FingerprintSet erkennt bereits ausgegebene Bäume
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_FINGERPRINT_HPP__
+#define __WEGEL_TDBP_FINGERPRINT_HPP__
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_set.hpp>
+
+/// Menge von Fingerabdrücken bereits ausgegebener Bäume
+/** Statt der Strings selbst werden nur 64-Bit-Fingerabdrücke (FNV-1a)
+  * gespeichert. Bei einer Million Bäume liegt die Wahrscheinlichkeit,
+  * dass zwei verschiedene Bäume denselben Abdruck haben, unter 1e-7.
+  */
+class FingerprintSet
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Fügt den Fingerabdruck eines Baumes hinzu
+	/** @param tree Baum als String
+	    @return Baum war neu ja/nein
+	  */
+	bool insert(const std::string& tree)
+	{
+		return seen.insert(fingerprint(tree)).second;
+	}
+
+	/// Fügt einen bereits berechneten Fingerabdruck hinzu
+	/** @param print Fingerabdruck
+	    @return Fingerabdruck war neu ja/nein
+	  */
+	bool insert(const boost::uint64_t print)
+	{
+		return seen.insert(print).second;
+	}
+
+	/// Leert die Menge
+	void clear()
+	{
+		seen.clear();
+	}
+
+	/// Gibt die Anzahl der Fingerabdrücke aus
+	unsigned size() const
+	{
+		return seen.size();
+	}
+
+	/// Berechnet den Fingerabdruck eines Strings
+	static boost::uint64_t fingerprint(const std::string& s)
+	{
+		boost::uint64_t hash = 14695981039346656037ULL;
+		for(std::string::const_iterator c = s.begin(); c != s.end(); ++c)
+		{
+			hash ^= static_cast<unsigned char>(*c);
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	boost::unordered_set<boost::uint64_t> seen;	///< Fingerabdrücke
+};
+
+#endif
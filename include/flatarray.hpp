@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// flatarray.hpp
+// Klassentemplate FlatArray hält ein eigenes oder fremdes flaches Feld
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_FLATARRAY_HPP__
+#define __WEGEL_TDBP_FLATARRAY_HPP__
+
+#include <vector>
+
+/// Flaches Feld, das eigenen Speicher hat oder fremden Speicher ansieht
+/** Beim Übersetzen der Grammatik wächst das Feld wie ein std::vector.
+  * Aus einem Cache geladene Felder zeigen dagegen nur in den eingeblendeten
+  * Speicher der Cache-Datei, ohne die Elemente zu kopieren; sie dürfen dann
+  * nicht mehr verändert werden. Lesend verhalten sich beide Formen gleich.
+  */
+template<typename T>
+class FlatArray
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor eines leeren Feldes
+	FlatArray()
+	{
+		first = 0;
+		count = 0;
+	}
+
+	/// Kopierkonstruktor, eigener Speicher wird mitkopiert
+	FlatArray(const FlatArray& other)
+		: owned(other.owned)
+	{
+		adopt(other);
+	}
+
+	/// Zuweisung, eigener Speicher wird mitkopiert
+	FlatArray& operator=(const FlatArray& other)
+	{
+		owned = other.owned;
+		adopt(other);
+		return *this;
+	}
+
+	/// Lässt das Feld auf fremden Speicher zeigen
+	/** @param data Erstes Element, muss so lange gültig bleiben wie das Feld
+	    @param size Anzahl der Elemente
+	  */
+	void view(const T* data, const unsigned size)
+	{
+		owned.clear();
+		first = data;
+		count = size;
+	}
+
+	/// Gibt die Anzahl der Elemente aus
+	unsigned size() const
+	{
+		return count;
+	}
+
+	/// Prüft, ob das Feld leer ist
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	/// Liefert einen Zeiger auf das erste Element, 0 für ein leeres Feld
+	const T* data() const
+	{
+		return first;
+	}
+
+	/// Liest ein Element
+	const T& operator[](const unsigned i) const
+	{
+		return first[i];
+	}
+
+	/// Verändert ein Element, nur für eigenen Speicher
+	T& operator[](const unsigned i)
+	{
+		return owned[i];
+	}
+
+	/// Füllt das Feld mit n Kopien eines Wertes
+	void assign(const unsigned n, const T& value)
+	{
+		owned.assign(n,value);
+		bind();
+	}
+
+	/// Leert das Feld
+	void clear()
+	{
+		owned.clear();
+		bind();
+	}
+
+	/// Hängt ein Element an
+	void push_back(const T& value)
+	{
+		owned.push_back(value);
+		bind();
+	}
+
+	/// Hängt einen Bereich von Elementen an
+	template<typename Iterator>
+	void append(Iterator begin, Iterator end)
+	{
+		owned.insert(owned.end(),begin,end);
+		bind();
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	std::vector<T> owned;	///< Eigener Speicher, leer bei fremdem Speicher
+	const T* first;			///< Erstes Element
+	unsigned count;			///< Anzahl der Elemente
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Richtet das Feld nach einer Änderung auf den eigenen Speicher aus
+	void bind()
+	{
+		first = owned.empty() ? 0 : &owned[0];
+		count = owned.size();
+	}
+
+	/// Übernimmt die Sicht eines anderen Feldes
+	void adopt(const FlatArray& other)
+	{
+		if(other.owned.empty())
+		{
+			first = other.first;
+			count = other.count;
+		}
+		else
+		{
+			bind();
+		}
+	}
+};
+
+#endif
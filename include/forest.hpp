@@ -0,0 +1,690 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// forest.hpp
+// Klasse ParseForest implementiert einen gepackten Parsewald
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_FOREST_HPP__
+#define __WEGEL_TDBP_FOREST_HPP__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <boost/cstdint.hpp>
+#include "globaltypes.hpp"
+#include "symboltable.hpp"
+
+/// Gepackter Parsewald
+/** Speichert alle Parsebäume eines Satzes platzsparend: Jeder Knoten
+  * (Symbol, Spanne) kommt nur einmal vor und hält die alternativen Folgen
+  * seiner Tochterknoten. Längere Folgen werden binär über Zwischenknoten
+  * gepackt, die ein Präfix einer rechten Regelseite überspannen. Der Wald
+  * kann alle Bäume im Wishtree/Showtree-Format aufzählen und verwirft dabei
+  * wie der Top-Down-Backtracking-Parser Bäume mit Linksrekursion.
+  */
+class ParseForest
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Arten von Knoten im Wald
+	enum NodeType {SYMBOL, INTERMEDIATE, TERMINAL};
+
+	/// Gepackte Alternative eines Knotens
+	/** Die Tochterfolge besteht aus den Töchtern des Präfix-Knotens und
+	  * dem letzten Tochterknoten. Ein Präfix von -1 bedeutet, dass die Folge
+	  * nur aus dem letzten Tochterknoten besteht.
+	  */
+	struct Packing
+	{
+		int	prefix;	///< Zwischen- oder Symbolknoten des Präfixes oder -1
+		int	last;	///< Letzter Tochterknoten
+
+		/// Konstruktor aus Präfix und letztem Tochterknoten
+		Packing(int p, int l)
+		{
+			prefix = p;
+			last = l;
+		}
+	};
+
+	/// Liste gepackter Alternativen
+	typedef std::vector<Packing> PackingList;
+
+	/// Knoten des Waldes
+	struct Node
+	{
+		NodeType	type;		///< Art des Knotens
+		unsigned	label;		///< Symbol, Terminal oder Regelpräfix
+		unsigned	begin;		///< Erste überspannte Input-Position
+		unsigned	end;		///< Position hinter der Spanne
+		PackingList	packings;	///< Alternative Tochterfolgen
+	};
+
+	/// Liste von Knoten
+	typedef std::vector<Node> NodeList;
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor eines leeren Waldes
+	ParseForest()
+	{
+		root = -1;
+	}
+
+	/// Fügt dem Wald einen Knoten hinzu
+	/** Legt einen Knoten ohne Alternativen an. Gleiche Knoten müssen vom
+	  * Aufrufer selbst zusammengeführt werden.
+	    @param type Art des Knotens
+	    @param label Symbolindex, Tokenindex oder vom Verfahren vergebene
+	           Nummer des Regelpräfixes
+	    @param begin Erste überspannte Input-Position
+	    @param end Position hinter der Spanne
+	    @return Index des neuen Knotens
+	  */
+	int add_node(const NodeType type, const unsigned label,
+	             const unsigned begin, const unsigned end)
+	{
+		Node n;
+		n.type = type;
+		n.label = label;
+		n.begin = begin;
+		n.end = end;
+		nodes.push_back(n);
+		return nodes.size() - 1;
+	}
+
+	/// Fügt einem Knoten eine gepackte Alternative hinzu
+	/** @param node Index des Knotens
+	    @param prefix Index des Präfix-Knotens oder -1
+	    @param last Index des letzten Tochterknotens
+	  */
+	void add_packing(const int node, const int prefix, const int last)
+	{
+		nodes[node].packings.push_back(Packing(prefix,last));
+	}
+
+	/// Legt den obersten Knoten fest
+	/** @param node Index des Knotens, der das Startsymbol über den ganzen
+	           Input darstellt
+	  */
+	void set_root(const int node)
+	{
+		root = node;
+	}
+
+	/// Gibt aus, ob der Wald mindestens einen Baum enthält
+	bool empty() const
+	{
+		return root == -1;
+	}
+
+	/// Leert den Wald
+	void clear()
+	{
+		nodes.clear();
+		root = -1;
+	}
+
+	/// Schreibt den Wald im Textformat
+	/** Die erste Zeile lautet <tt>wald Knotenzahl Wurzel</tt>, danach folgt
+	  * pro Knoten eine Zeile <tt>Art Name Anfang Ende Alternativen</tt>.
+	  * Die Knoten sind in Dateireihenfolge ab 0 nummeriert, die Wurzel ist
+	  * -1, wenn der Satz keinen Baum hat. Die Art ist S (Symbol), Z
+	  * (Zwischenknoten, Name ist die Nummer des Regelpräfixes) oder T
+	  * (Terminal). Jede Alternative hat die Form <tt>Präfix:Letzter</tt>
+	  * mit den Nummern der Knoten, Präfix -1 steht für eine Folge aus
+	  * nur einem Knoten. Die Größe wächst nur polynomiell mit der Satzlänge.
+	    @param out Ausgabe
+	    @param symbols Tabelle der Symbole
+	    @param tokens Tabelle der Terminale
+	  */
+	void write(std::ostream& out, const SymbolTable& symbols,
+	           const SymbolTable& tokens) const
+	{
+		out << "wald " << nodes.size() << ' ' << root << "\n";
+		for(NodeList::const_iterator n = nodes.begin(); n != nodes.end(); ++n)
+		{
+			if(n->type == SYMBOL)
+			{
+				out << "S " << symbols.name(n->label);
+			}
+			else if(n->type == INTERMEDIATE)
+			{
+				out << "Z " << n->label;
+			}
+			else
+			{
+				out << "T " << tokens.name(n->label);
+			}
+			out << ' ' << n->begin << ' ' << n->end;
+			for(PackingList::const_iterator p = n->packings.begin();
+			    p != n->packings.end(); ++p)
+			{
+				out << ' ' << p->prefix << ':' << p->last;
+			}
+			out << "\n";
+		}
+	}
+
+	/// Liest einen Wald im Textformat von write()
+	/** Symbole und Terminale werden in die übergebenen Tabellen
+	  * aufgenommen, sodass zum Aufzählen keine Grammatik nötig ist. Ein
+	  * Wald wird nur angenommen, wenn trees() über ihn terminiert: Jede
+	  * Tochter einer Alternative ist ein anderer Knoten mit kürzerer
+	  * Spanne. Nur einstellige Alternativen eines Symbolknotens dürfen auf
+	  * ein Terminal oder einen Symbolknoten gleicher Spanne zeigen, auch
+	  * auf sich selbst; Zyklen über solche Regeln schneidet die Linkskette
+	  * beim Aufzählen ab.
+	    @param in Eingabe, die vor der Kopfzeile des Waldes steht
+	    @param symbols Tabelle der Symbole
+	    @param tokens Tabelle der Terminale
+	    @return Wald fehlerfrei gelesen ja/nein
+	  */
+	bool read(std::istream& in, SymbolTable& symbols, SymbolTable& tokens)
+	{
+		clear();
+		std::string line;
+		std::string keyword;
+		unsigned count = 0;
+		if(!std::getline(in,line))
+		{
+			return false;
+		}
+		std::istringstream header(line);
+		if(!(header >> keyword >> count >> root) || keyword != "wald")
+		{
+			return false;
+		}
+		nodes.resize(count);
+		for(NodeList::iterator n = nodes.begin(); n != nodes.end(); ++n)
+		{
+			std::string type;
+			std::string name;
+			if(!std::getline(in,line))
+			{
+				return false;
+			}
+			std::istringstream fields(line);
+			if(!(fields >> type >> name >> n->begin >> n->end) ||
+			   n->begin >= n->end)
+			{
+				return false;
+			}
+			if(type == "S")
+			{
+				n->type = SYMBOL;
+				n->label = symbols.intern(name);
+			}
+			else if(type == "Z")
+			{
+				n->type = INTERMEDIATE;
+				n->label = std::atoi(name.c_str());
+			}
+			else if(type == "T")
+			{
+				n->type = TERMINAL;
+				n->label = tokens.intern(name);
+			}
+			else
+			{
+				return false;
+			}
+			int prefix;
+			int last;
+			char colon;
+			while(fields >> prefix >> colon >> last)
+			{
+				if(colon != ':' || prefix < -1 || prefix >= int(count) ||
+				   last < 0 || last >= int(count))
+				{
+					return false;
+				}
+				n->packings.push_back(Packing(prefix,last));
+			}
+			if(!fields.eof())
+			{
+				return false;
+			}
+		}
+		for(unsigned n = 0; n < count; ++n)
+		{
+			for(PackingList::const_iterator p = nodes[n].packings.begin();
+			    p != nodes[n].packings.end(); ++p)
+			{
+				if(!valid_packing(n,*p))
+				{
+					return false;
+				}
+			}
+		}
+		return root >= -1 && root < int(count);
+	}
+
+	/// Zählt alle Bäume des Waldes auf
+	/** Fügt alle Bäume des Waldes im Wishtree/Showtree-Format in eine Menge
+	  * von Bäumen ein. Bäume, in denen ein Symbol sich selbst links
+	  * expandiert, werden wie im Top-Down-Backtracking-Parser verworfen.
+	    @param trees Menge, in die die Bäume eingefügt werden
+	    @param symbols Tabelle der Symbole
+	    @param tokens Tabelle der Terminale
+	    @param log Ausgabe für Warnungen
+	  */
+	void trees(TreeSet& trees, const SymbolTable& symbols,
+	           const SymbolTable& tokens, std::ostream& log) const
+	{
+		if(!empty())
+		{
+			Expander expander(*this,symbols,tokens,log);
+			const StringList& found = expander.expand(root);
+			trees.insert(found.begin(),found.end());
+		}
+	}
+
+	/// Zählt die Bäume des Waldes, ohne sie aufzubauen
+	/** Summiert die gepackten Alternativen von unten nach oben und merkt
+	  * sich die Anzahl pro Knoten und Linkskette, sodass die Zahl mit
+	  * trees() übereinstimmt, aber nur polynomiell viel Zeit braucht. Die
+	  * Zählung sättigt bei einer Grenze; mit Grenze 1 endet sie, sobald
+	  * ein Baum feststeht.
+	    @param symbols Tabelle der Symbole
+	    @param log Ausgabe für Warnungen
+	    @param limit Höchstens gezählte Anzahl
+	    @return Anzahl der Bäume, höchstens limit
+	  */
+	boost::uint64_t count(const SymbolTable& symbols, std::ostream& log,
+	                      const boost::uint64_t limit) const
+	{
+		if(empty())
+		{
+			return 0;
+		}
+		Counter counter(*this,symbols,log,limit);
+		return counter.count(root);
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Liste von Strings
+	typedef std::vector<std::string> StringList;
+
+	/// Länge der Spanne eines Knotens
+	unsigned span(const int node) const
+	{
+		return nodes[node].end-nodes[node].begin;
+	}
+
+	/// Prüft eine gelesene Alternative, siehe read()
+	/** @param node Index des Knotens
+	    @param p Alternative des Knotens
+	    @return Alternative zulässig ja/nein
+	  */
+	bool valid_packing(const int node, const Packing& p) const
+	{
+		const Node& n = nodes[node];
+		if(n.type == TERMINAL || p.prefix == node)
+		{
+			return false;
+		}
+		if(p.prefix != -1)
+		{
+			return span(p.prefix) < span(node) && span(p.last) < span(node);
+		}
+		return span(p.last) < span(node) ||
+		       (n.type == SYMBOL && nodes[p.last].type != INTERMEDIATE &&
+		        span(p.last) == span(node));
+	}
+
+	/// Sortierte Liste der Symbole, die gerade linksexpandiert werden
+	typedef std::vector<unsigned> Chain;
+
+	/// Aufzähler der Bäume eines Waldes
+	/** Setzt die Strings der Teilbäume von unten nach oben zusammen und
+	  * merkt sich bereits aufgebaute Teilbäume pro Knoten und Linkskette.
+	  * Ein expliziter Stapel ersetzt die Rekursion, da die Tiefe des Waldes
+	  * mit der Satzlänge wächst.
+	  */
+	class Expander
+	{
+		public:
+
+		/// Konstruktor aus einem Wald, den Tabellen und der Ausgabe für Warnungen
+		Expander(const ParseForest& f, const SymbolTable& s,
+		         const SymbolTable& t, std::ostream& l)
+			: forest(f), symbols(s), tokens(t), log(l)
+		{
+		}
+
+		/// Liefert alle Strings zu einem Knoten
+		/** Für Symbolknoten sind das Teilbäume, für Terminale das Token mit
+		  * Strich, für Zwischenknoten die mit Kommas verbundenen Teilbäume
+		  * ihrer Töchter.
+		    @param node Index des Knotens
+		    @return Liste der Strings
+		  */
+		const StringList& expand(const int node)
+		{
+			Memo::iterator top = lookup(node,Chain());
+			while(!stack.empty())
+			{
+				const std::size_t current = stack.size()-1;
+				const Node& n = forest.nodes[stack[current].entry->first.first];
+				if(stack[current].next == n.packings.size())
+				{
+					stack.pop_back();
+					continue;
+				}
+
+				// Erste Tochter erhält die Linkskette, die letzte eine leere
+				const Packing& p = n.packings[stack[current].next];
+				Memo::iterator first = stack[current].first;
+				if(first == memo.end())
+				{
+					first = lookup(p.prefix == -1 ? p.last : p.prefix,
+					               stack[current].chain);
+					stack[current].first = first;
+					if(stack.size() > current+1)
+					{
+						continue;
+					}
+				}
+				StringList& result = stack[current].entry->second;
+				if(p.prefix == -1)
+				{
+					for(StringList::const_iterator i = first->second.begin();
+					    i != first->second.end(); ++i)
+					{
+						append(result,n,*i);
+					}
+				}
+				else
+				{
+					Memo::iterator last = lookup(p.last,Chain());
+					if(stack.size() > current+1)
+					{
+						continue;
+					}
+					for(StringList::const_iterator i = first->second.begin();
+					    i != first->second.end(); ++i)
+					{
+						for(StringList::const_iterator j = last->second.begin();
+						    j != last->second.end(); ++j)
+						{
+							append(result,n,*i+','+*j);
+						}
+					}
+				}
+				++stack[current].next;
+				stack[current].first = memo.end();
+			}
+			return top->second;
+		}
+
+		private:
+
+		/// Map Knoten, Linkskette -> Strings
+		typedef std::map<std::pair<int,Chain>,StringList> Memo;
+
+		/// Knoten, dessen Alternativen gerade aufgebaut werden
+		struct Frame
+		{
+			Memo::iterator	entry;	///< Eintrag des Knotens
+			Chain			chain;	///< Linkskette der ersten Tochter
+			std::size_t		next;	///< Index der nächsten Alternative
+			Memo::iterator	first;	///< Erste Tochter der Alternative
+
+			/// Konstruktor aus Eintrag, Linkskette und leerem Iterator
+			Frame(Memo::iterator e, const Chain& c, Memo::iterator none)
+				: entry(e), chain(c), next(0), first(none)
+			{
+			}
+		};
+
+		const ParseForest& forest;	///< Aufzuzählender Wald
+		const SymbolTable& symbols;	///< Tabelle der Symbole
+		const SymbolTable& tokens;	///< Tabelle der Terminale
+		std::ostream& log;			///< Ausgabe für Warnungen
+		Memo memo;					///< Bereits aufgebaute Strings
+		std::vector<Frame> stack;	///< Knoten mit fehlenden Töchtern
+		std::set<unsigned> warned;	///< Symbole mit ausgegebener Warnung
+
+		/// Liefert den Eintrag eines Knotens und legt ihn beim ersten Mal an
+		/** Blätter und abgeschnittene Linksrekursionen sind sofort fertig,
+		  * andere Knoten kommen auf den Stapel.
+		    @param node Index des Knotens
+		    @param chain Symbole, die links über dem Knoten expandiert werden
+		    @return Eintrag des Knotens
+		  */
+		Memo::iterator lookup(const int node, const Chain& chain)
+		{
+			std::pair<Memo::iterator,bool> entry =
+				memo.insert(std::make_pair(std::make_pair(node,chain),
+				                           StringList()));
+			if(!entry.second)
+			{
+				return entry.first;
+			}
+			const Node& n = forest.nodes[node];
+			if(n.type == TERMINAL)
+			{
+				entry.first->second.push_back('-'+tokens.name(n.label));
+			}
+			else if(n.type == INTERMEDIATE)
+			{
+				// Präfix einer Regelseite, Linkskette geht an die erste Tochter
+				stack.push_back(Frame(entry.first,chain,memo.end()));
+			}
+			else if(std::binary_search(chain.begin(),chain.end(),n.label))
+			{
+				// Linksrekursion, Warnhinweis einmal pro Symbol ausgeben
+				if(warned.insert(n.label).second)
+				{
+					log << "Warnung: Linksrekursion bei der Expansion des "
+					          << "Symbols '" << symbols.name(n.label)
+					          << "' entdeckt. "
+					          << "Entsprechende Regeln werden ignoriert.\n";
+				}
+			}
+			else
+			{
+				// Symbol in die Linkskette der ersten Tochter aufnehmen
+				Chain child_chain(chain);
+				child_chain.insert(std::lower_bound(child_chain.begin(),
+				                                    child_chain.end(),n.label),
+				                   n.label);
+				stack.push_back(Frame(entry.first,child_chain,memo.end()));
+			}
+			return entry.first;
+		}
+
+		/// Hängt eine Tochterfolge an, bei Symbolknoten als Teilbaum
+		/** @param result Liste der Strings des Knotens
+		    @param n Knoten
+		    @param children Mit Kommas verbundene Teilbäume der Töchter
+		  */
+		void append(StringList& result, const Node& n,
+		            const std::string& children) const
+		{
+			if(n.type == SYMBOL)
+			{
+				result.push_back(symbols.name(n.label)+"/["+children+']');
+			}
+			else
+			{
+				result.push_back(children);
+			}
+		}
+	};
+	friend class Expander;
+
+	/// Zähler der Bäume eines Waldes
+	/** Folgt denselben Regeln und demselben Stapel wie der Expander, rechnet
+	  * aber mit Anzahlen statt mit Strings.
+	  */
+	class Counter
+	{
+		public:
+
+		/// Konstruktor aus einem Wald, der Tabelle, den Warnungen und der Grenze
+		Counter(const ParseForest& f, const SymbolTable& s, std::ostream& l,
+		        const boost::uint64_t m)
+			: forest(f), symbols(s), log(l), limit(m)
+		{
+		}
+
+		/// Liefert die Anzahl der Teilbäume zu einem Knoten
+		/** @param node Index des Knotens
+		    @return Anzahl, höchstens die Grenze
+		  */
+		boost::uint64_t count(const int node)
+		{
+			Memo::iterator top = lookup(node,Chain());
+			while(!stack.empty())
+			{
+				const std::size_t current = stack.size()-1;
+				const Node& n = forest.nodes[stack[current].entry->first.first];
+				boost::uint64_t& result = stack[current].entry->second;
+				if(stack[current].next == n.packings.size() || result >= limit)
+				{
+					stack.pop_back();
+					continue;
+				}
+
+				// Erste Tochter erhält die Linkskette, die letzte eine leere
+				const Packing& p = n.packings[stack[current].next];
+				Memo::iterator first = stack[current].first;
+				if(first == memo.end())
+				{
+					first = lookup(p.prefix == -1 ? p.last : p.prefix,
+					               stack[current].chain);
+					stack[current].first = first;
+					if(stack.size() > current+1)
+					{
+						continue;
+					}
+				}
+				boost::uint64_t found = first->second;
+				if(p.prefix != -1 && found > 0)
+				{
+					Memo::iterator last = lookup(p.last,Chain());
+					if(stack.size() > current+1)
+					{
+						continue;
+					}
+					found = last->second > limit/found ? limit
+					                                   : found*last->second;
+				}
+				result = found > limit-result ? limit : result+found;
+				++stack[current].next;
+				stack[current].first = memo.end();
+			}
+			return top->second;
+		}
+
+		private:
+
+		/// Map Knoten, Linkskette -> Anzahl
+		typedef std::map<std::pair<int,Chain>,boost::uint64_t> Memo;
+
+		/// Knoten, dessen Alternativen gerade gezählt werden
+		struct Frame
+		{
+			Memo::iterator	entry;	///< Eintrag des Knotens
+			Chain			chain;	///< Linkskette der ersten Tochter
+			std::size_t		next;	///< Index der nächsten Alternative
+			Memo::iterator	first;	///< Erste Tochter der Alternative
+
+			/// Konstruktor aus Eintrag, Linkskette und leerem Iterator
+			Frame(Memo::iterator e, const Chain& c, Memo::iterator none)
+				: entry(e), chain(c), next(0), first(none)
+			{
+			}
+		};
+
+		const ParseForest& forest;	///< Zu zählender Wald
+		const SymbolTable& symbols;	///< Tabelle der Symbole
+		std::ostream& log;			///< Ausgabe für Warnungen
+		boost::uint64_t limit;		///< Grenze, bei der die Zählung sättigt
+		Memo memo;					///< Bereits gezählte Knoten
+		std::vector<Frame> stack;	///< Knoten mit fehlenden Töchtern
+		std::set<unsigned> warned;	///< Symbole mit ausgegebener Warnung
+
+		/// Liefert den Eintrag eines Knotens und legt ihn beim ersten Mal an
+		/** Wie Expander::lookup().
+		    @param node Index des Knotens
+		    @param chain Symbole, die links über dem Knoten expandiert werden
+		    @return Eintrag des Knotens
+		  */
+		Memo::iterator lookup(const int node, const Chain& chain)
+		{
+			std::pair<Memo::iterator,bool> entry =
+				memo.insert(std::make_pair(std::make_pair(node,chain),
+				                           boost::uint64_t(0)));
+			if(!entry.second)
+			{
+				return entry.first;
+			}
+			const Node& n = forest.nodes[node];
+			if(n.type == TERMINAL)
+			{
+				entry.first->second = 1;
+			}
+			else if(n.type == INTERMEDIATE)
+			{
+				stack.push_back(Frame(entry.first,chain,memo.end()));
+			}
+			else if(std::binary_search(chain.begin(),chain.end(),n.label))
+			{
+				// Linksrekursion, Warnhinweis einmal pro Symbol ausgeben
+				if(warned.insert(n.label).second)
+				{
+					log << "Warnung: Linksrekursion bei der Expansion des "
+					          << "Symbols '" << symbols.name(n.label)
+					          << "' entdeckt. "
+					          << "Entsprechende Regeln werden ignoriert.\n";
+				}
+			}
+			else
+			{
+				Chain child_chain(chain);
+				child_chain.insert(std::lower_bound(child_chain.begin(),
+				                                    child_chain.end(),n.label),
+				                   n.label);
+				stack.push_back(Frame(entry.first,child_chain,memo.end()));
+			}
+			return entry.first;
+		}
+	};
+	friend class Counter;
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	NodeList nodes;	///< Knoten des Waldes
+	int root;		///< Index des obersten Knotens oder -1
+};
+
+#endif
@@ -21,13 +21,13 @@
 
 #include <string>
 #include <list>
+#include <set>
+#include <vector>
+#include <boost/unordered_map.hpp>
 
 /// Token des Inputs
 typedef std::string Token;
 
-/// Tokenisierter Input
-typedef std::list<Token> TokenList;
-
 /// Symbol als abstrakte Kategorie
 typedef std::string Symbol;
 
@@ -37,47 +37,25 @@ typedef std::list<Symbol> SymbolList;
 /// Liste von Listen von Symbolen
 typedef std::list<SymbolList> SymbolListList;
 
-/// Konkrete, identifizierbare Instanz eines Symbols
-struct SymbolInstance
-{
-	Symbol	symbol;	///< Symbol
-	int		id;		///< ID zur Identifikation
+/// Menge von Symbolen
+typedef std::set<Symbol> SymbolSet;
 
-	/// Konstruktor für leere Instanz
-	SymbolInstance()
-	{
-		symbol = Symbol("");
-		id = -1;
-	}
+/// Map mit Produktionsregeln Symbol -> Liste von rechten Regelseiten
+typedef boost::unordered_map<Symbol,SymbolListList> Grammar;
 
-	/// Konstruktor aus Symbol und ID
-	SymbolInstance(Symbol s, int i)
-	{
-		symbol = s;
-		id = i;
-	}
+/// Menge von Bäumen
+typedef std::set<std::string> TreeSet;
 
-	/// Kopie-Konstruktor
-	SymbolInstance(const SymbolInstance& rhs)
-	{
-		symbol = rhs.symbol;
-		id = rhs.id;
-	}
+/// Symbol als Index in der Symboltabelle
+typedef unsigned SymbolId;
 
-	/// Gleichheits-Operator
-	bool operator==(const SymbolInstance& rhs) const
-	{
-		return id == rhs.id;
-	}
+/// Token als Index in der Tabelle der Terminale
+typedef unsigned TokenId;
 
-	/// Kleiner-als-Operator
-	bool operator<(const SymbolInstance& rhs) const
-	{
-		return id < rhs.id;
-	}
-};
+/// Liste von Symbolindizes, etwa eine rechte Regelseite
+typedef std::vector<SymbolId> SymbolIdList;
 
-/// Liste von Symbolinstanzen
-typedef std::list<SymbolInstance> SymbolInstanceList;
+/// Tokenisierter Input als Liste von Tokenindizes
+typedef std::vector<TokenId> TokenIdList;
 
 #endif
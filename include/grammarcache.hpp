@@ -0,0 +1,338 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// grammarcache.hpp
+// Klasse GrammarCache speichert übersetzte Grammatiken als Binärdatei
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_GRAMMARCACHE_HPP__
+#define __WEGEL_TDBP_GRAMMARCACHE_HPP__
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "compiledgrammar.hpp"
+#include "flatarray.hpp"
+
+/// Binärer Cache für übersetzte Grammatiken
+/** Schreibt eine CompiledGrammar mit ihren Symboltabellen als versionierte
+  * Binärdatei. Die Datei beginnt mit einem Kopf, der Version, Byte-
+  * reihenfolge sowie Größe und Änderungszeit der Quelldateien festhält.
+  * Danach folgen alle Zahlen und flachen Felder der Grammatik in der
+  * Reihenfolge von CompiledGrammar::visit(), jedes Feld als Anzahl und auf
+  * 8 Bytes ausgerichtete Elemente.
+  *
+  * Beim Laden wird die Datei in den Speicher eingeblendet, und die Felder
+  * der Grammatik zeigen direkt hinein; es wird pro Eintrag nichts kopiert
+  * oder angelegt. Passt der Kopf nicht zu den Quelldateien, gilt der Cache
+  * als veraltet. Die Änderungszeiten werden, wo das System sie liefert, auf
+  * Nanosekunden genau verglichen, damit auch eine Änderung in derselben
+  * Sekunde wie das Schreiben des Caches erkannt wird. Die Indizes der
+  * eingeblendeten Felder werden vor der Verwendung geprüft.
+  */
+class GrammarCache
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Kopf der Cache-Datei
+	struct Header
+	{
+		char			magic[8];		///< "TDBPGC" und Nullbytes
+		boost::uint32_t	version;		///< Version des Formats
+		boost::uint32_t	order;			///< 0x01020304 in Bytereihenfolge
+		boost::uint32_t	word_size;		///< Größe eines BitWord
+		boost::uint32_t	reserved;		///< Immer 0
+		boost::uint64_t	grammar_size;	///< Größe der Grammatikdatei
+		boost::uint64_t	grammar_time;	///< Änderungszeit der Grammatik in ns
+		boost::uint64_t	lexicon_size;	///< Größe der Lexikondatei
+		boost::uint64_t	lexicon_time;	///< Änderungszeit des Lexikons in ns
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Baut den Kopf für die aktuellen Quelldateien
+	/** @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @param head Kopf
+	    @return Quelldateien vorhanden ja/nein
+	  */
+	static bool header(const std::string& grammarfile,
+	                   const std::string& lexiconfile, Header& head)
+	{
+		std::memset(&head,0,sizeof(Header));
+		std::memcpy(head.magic,"TDBPGC",6);
+		head.version = VERSION;
+		head.order = 0x01020304;
+		head.word_size = sizeof(BitWord);
+		return stamp(grammarfile,head.grammar_size,head.grammar_time) &&
+		       stamp(lexiconfile,head.lexicon_size,head.lexicon_time);
+	}
+
+	/// Blendet eine übersetzte Grammatik aus dem Cache ein
+	/** @param cachefile Dateiname des Caches
+	    @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @param grammar Grammatik, deren Felder in den Cache zeigen
+	    @return Cache vorhanden, aktuell und lesbar ja/nein
+	  */
+	static bool load(const std::string& cachefile,
+	                 const std::string& grammarfile,
+	                 const std::string& lexiconfile, CompiledGrammar& grammar)
+	{
+		Header expected;
+		if(!header(grammarfile,lexiconfile,expected))
+		{
+			return false;
+		}
+		boost::shared_ptr<boost::interprocess::mapped_region> region;
+		try
+		{
+			boost::interprocess::file_mapping file(cachefile.c_str(),
+			                                       boost::interprocess::read_only);
+			region.reset(new boost::interprocess::mapped_region(file,
+			             boost::interprocess::read_only));
+		}
+		catch(const boost::interprocess::interprocess_exception&)
+		{
+			return false;
+		}
+		const char* base = static_cast<const char*>(region->get_address());
+		const std::size_t size = region->get_size();
+		if(size < sizeof(Header) ||
+		   std::memcmp(base,&expected,sizeof(Header)) != 0)
+		{
+			return false;
+		}
+		CompiledGrammar mapped;
+		Reader reader(base,size);
+		mapped.visit(reader);
+		if(!reader.complete() || !mapped.valid())
+		{
+			return false;
+		}
+		mapped.attach(region);
+		grammar = mapped;
+		return true;
+	}
+
+	/// Schreibt eine übersetzte Grammatik in den Cache
+	/** Schreibt zuerst in eine temporäre Datei mit Prozess- und Threadnummer
+	  * im Namen und benennt sie dann um, damit andere Prozesse nie einen
+	  * halb geschriebenen Cache sehen und gleichzeitig Schreibende sich
+	  * nicht gegenseitig die Datei überschreiben. Der Kopf muss vor
+	  * dem Einlesen der Quelldateien mit header() gebildet werden; wurden
+	  * sie danach noch geändert, gilt der Cache beim nächsten Laden als
+	  * veraltet.
+	    @param cachefile Dateiname des Caches
+	    @param head Kopf für die Quelldateien vor dem Einlesen
+	    @param grammar Übersetzte Grammatik
+	    @return Cache geschrieben ja/nein
+	  */
+	static bool save(const std::string& cachefile, const Header& head,
+	                 CompiledGrammar& grammar)
+	{
+		std::ostringstream temporary_name;
+		temporary_name << cachefile << '.' << process_id() << '.'
+		               << boost::this_thread::get_id() << ".tmp";
+		const std::string temporary = temporary_name.str();
+		{
+			std::ofstream out(temporary.c_str(),std::ios::binary);
+			out.write(reinterpret_cast<const char*>(&head),sizeof(Header));
+			Writer writer(out,sizeof(Header));
+			grammar.visit(writer);
+			if(!out)
+			{
+				std::remove(temporary.c_str());
+				return false;
+			}
+		}
+		std::remove(cachefile.c_str());
+		return std::rename(temporary.c_str(),cachefile.c_str()) == 0;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Version des Dateiformats, bei jeder Änderung hochzählen
+	enum {VERSION = 4};
+
+	/// Besucher, der die Daten einer Grammatik schreibt
+	class Writer
+	{
+		public:
+
+		/// Konstruktor aus Ausgabe und bereits geschriebener Länge
+		Writer(std::ostream& o, const std::size_t p)
+			: out(o), pos(p)
+		{
+		}
+
+		/// Schreibt eine Zahl
+		void operator()(unsigned& value)
+		{
+			boost::uint32_t v = value;
+			write(&v,sizeof(v));
+		}
+
+		/// Schreibt ein Feld
+		template<typename T>
+		void operator()(FlatArray<T>& array)
+		{
+			unsigned n = array.size();
+			(*this)(n);
+			pad();
+			write(array.data(),array.size()*sizeof(T));
+		}
+
+		private:
+
+		std::ostream& out;	///< Ausgabe
+		std::size_t pos;	///< Bisher geschriebene Bytes
+
+		/// Schreibt Bytes
+		void write(const void* data, const std::size_t length)
+		{
+			out.write(static_cast<const char*>(data),length);
+			pos += length;
+		}
+
+		/// Füllt bis zur nächsten 8-Byte-Grenze auf
+		void pad()
+		{
+			static const char zeros[8] = {0};
+			write(zeros,(8-pos%8)%8);
+		}
+	};
+
+	/// Besucher, der die Felder einer Grammatik in den Cache zeigen lässt
+	class Reader
+	{
+		public:
+
+		/// Konstruktor aus eingeblendetem Speicher
+		Reader(const char* b, const std::size_t s)
+			: base(b), size(s), pos(sizeof(Header)), valid(true)
+		{
+		}
+
+		/// Liest eine Zahl
+		void operator()(unsigned& value)
+		{
+			boost::uint32_t v = 0;
+			if(take(sizeof(v)))
+			{
+				std::memcpy(&v,base+pos-sizeof(v),sizeof(v));
+			}
+			value = v;
+		}
+
+		/// Lässt ein Feld in den Speicher zeigen
+		template<typename T>
+		void operator()(FlatArray<T>& array)
+		{
+			unsigned n = 0;
+			(*this)(n);
+			take((8-pos%8)%8);
+			if(valid && n > (size-pos)/sizeof(T))
+			{
+				valid = false;
+			}
+			if(take(n*sizeof(T)))
+			{
+				array.view(reinterpret_cast<const T*>(base+pos-n*sizeof(T)),n);
+			}
+		}
+
+		/// Prüft, ob alle Daten fehlerfrei und vollständig gelesen wurden
+		bool complete() const
+		{
+			return valid && pos == size;
+		}
+
+		private:
+
+		const char* base;	///< Anfang des eingeblendeten Speichers
+		std::size_t size;	///< Größe des eingeblendeten Speichers
+		std::size_t pos;	///< Bisher gelesene Bytes
+		bool valid;			///< Bisher kein Fehler
+
+		/// Rückt über Bytes vor, sofern genug vorhanden sind
+		bool take(const std::size_t length)
+		{
+			if(!valid || length > size-pos)
+			{
+				valid = false;
+				return false;
+			}
+			pos += length;
+			return true;
+		}
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Liest Größe und Änderungszeit einer Datei
+	/** Die Zeit ist in Nanosekunden angegeben; wo das System nur Sekunden
+	  * liefert, wie unter Windows, ist der Rest 0.
+	  */
+	static bool stamp(const std::string& file, boost::uint64_t& size,
+	                  boost::uint64_t& time)
+	{
+		struct stat info;
+		if(stat(file.c_str(),&info) != 0)
+		{
+			return false;
+		}
+		size = info.st_size;
+		time = boost::uint64_t(info.st_mtime)*1000000000ULL;
+#if defined(__APPLE__)
+		time += info.st_mtimespec.tv_nsec;
+#elif defined(__unix__)
+		time += info.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+
+	/// Liefert die Nummer des laufenden Prozesses
+	static long process_id()
+	{
+#if defined(_WIN32)
+		return _getpid();
+#else
+		return getpid();
+#endif
+	}
+};
+
+#endif
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// lexiconentries.hpp
+// Klasse LexiconEntries sammelt eingelesene Lexikonregeln kompakt
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_LEXICONENTRIES_HPP__
+#define __WEGEL_TDBP_LEXICONENTRIES_HPP__
+
+#include <vector>
+#include <utility>
+#include "globaltypes.hpp"
+#include "symboltable.hpp"
+
+/// Kompakt gesammelte Lexikonregeln
+/** Nimmt die Regeln beim Einlesen des Lexikons auf, ohne pro Wort Strings
+  * oder Mengen anzulegen: Tokens und Kategorien werden sofort in je einer
+  * Symboltabelle abgelegt, jede Regel ist nur ein Paar ihrer Indizes.
+  * Doppelte Regeln bleiben zunächst stehen und werden erst beim Übersetzen
+  * der Grammatik entfernt.
+  */
+class LexiconEntries
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Lexikonregel als Paar aus Token und Kategorie
+	typedef std::pair<TokenId,SymbolId> Entry;
+
+	/// Liste von Lexikonregeln
+	typedef std::vector<Entry> EntryList;
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Fügt eine Lexikonregel hinzu
+	/** @param token Terminal
+	    @param category Präterminal, aus dem das Terminal abgeleitet wird
+	  */
+	void add(const Token& token, const Symbol& category)
+	{
+		entries.push_back(Entry(tokens.intern(token),
+		                        categories.intern(category)));
+	}
+
+	/// Übernimmt alle Regeln einer anderen Sammlung
+	/** Jeder String der anderen Sammlung wird dabei nur einmal übertragen.
+	    @param other Sammlung, etwa aus einem anderen Abschnitt des Lexikons
+	  */
+	void merge(const LexiconEntries& other)
+	{
+		std::vector<TokenId> token_ids(other.tokens.size());
+		for(TokenId t = 0; t < token_ids.size(); ++t)
+		{
+			token_ids[t] = tokens.intern(other.tokens.name(t));
+		}
+		std::vector<SymbolId> category_ids(other.categories.size());
+		for(SymbolId c = 0; c < category_ids.size(); ++c)
+		{
+			category_ids[c] = categories.intern(other.categories.name(c));
+		}
+		entries.reserve(entries.size()+other.entries.size());
+		for(EntryList::const_iterator e = other.entries.begin();
+		    e != other.entries.end(); ++e)
+		{
+			entries.push_back(Entry(token_ids[e->first],
+			                        category_ids[e->second]));
+		}
+	}
+
+	/// Liefert die Tabelle der Tokens
+	const SymbolTable& token_table() const
+	{
+		return tokens;
+	}
+
+	/// Liefert die Tabelle der Kategorien
+	const SymbolTable& category_table() const
+	{
+		return categories;
+	}
+
+	/// Liefert alle Regeln in der Reihenfolge des Einlesens
+	const EntryList& list() const
+	{
+		return entries;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	SymbolTable tokens;		///< Terminale
+	SymbolTable categories;	///< Präterminale
+	EntryList entries;		///< Regeln als Paare von Indizes
+};
+
+#endif
@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// persistentlist.hpp
+// Klassentemplate PersistentList implementiert eine unveränderliche Liste
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_PERSISTENTLIST_HPP__
+#define __WEGEL_TDBP_PERSISTENTLIST_HPP__
+
+#include <cstddef>
+#include <iterator>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+/// Unveränderliche, einfach verkettete Liste mit geteiltem Rest
+/** Das Voranstellen eines Elements erzeugt eine neue Liste in konstanter
+  * Zeit, die ihren Rest mit der alten Liste teilt. Kopien sind billig, weil
+  * nur ein Zeiger kopiert wird. Nicht mehr referenzierte Glieder werden
+  * automatisch freigegeben, auch bei sehr langen Listen ohne Rekursion.
+  */
+template<typename T>
+class PersistentList
+{
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Glied der Liste
+	struct Cell
+	{
+		T							head;	///< Element
+		boost::shared_ptr<const Cell>	tail;	///< Restliche Glieder
+
+		/// Konstruktor aus Element und Rest
+		Cell(const T& h, const boost::shared_ptr<const Cell>& t)
+			: head(h), tail(t)
+		{
+		}
+	};
+
+	public:
+
+	/// Iterator vom ersten zum letzten Element
+	class const_iterator
+	{
+		public:
+
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef T							value_type;
+		typedef std::ptrdiff_t				difference_type;
+		typedef const T*					pointer;
+		typedef const T&					reference;
+
+		/// Konstruktor aus einem Glied, 0 für das Ende
+		const_iterator(const Cell* c = 0) : cell(c)
+		{
+		}
+
+		/// Liefert das aktuelle Element
+		const T& operator*() const
+		{
+			return cell->head;
+		}
+
+		/// Liefert einen Zeiger auf das aktuelle Element
+		const T* operator->() const
+		{
+			return &cell->head;
+		}
+
+		/// Rückt ein Element weiter
+		const_iterator& operator++()
+		{
+			cell = cell->tail.get();
+			return *this;
+		}
+
+		/// Gleichheits-Operator
+		bool operator==(const const_iterator& rhs) const
+		{
+			return cell == rhs.cell;
+		}
+
+		/// Ungleichheits-Operator
+		bool operator!=(const const_iterator& rhs) const
+		{
+			return cell != rhs.cell;
+		}
+
+		private:
+
+		const Cell* cell;	///< Aktuelles Glied
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor einer leeren Liste
+	PersistentList()
+	{
+	}
+
+	/// Konstruktor, der einer Liste ein Element voranstellt
+	/** @param head Neues erstes Element
+	    @param tail Bestehende Liste, die zum Rest der neuen wird
+	  */
+	PersistentList(const T& head, const PersistentList& tail)
+		: first(boost::make_shared<const Cell>(head,tail.first))
+	{
+	}
+
+	/// Kopierkonstruktor, teilt alle Glieder mit der kopierten Liste
+	PersistentList(const PersistentList& rhs)
+		: first(rhs.first)
+	{
+	}
+
+	/// Destruktor
+	/** Gibt die Glieder, die nur noch diese Liste hält, eines nach dem
+	  * anderen frei. Sonst gäbe jedes Glied seinen Rest im eigenen
+	  * Destruktor frei, und lange Listen ließen den Aufrufstapel
+	  * überlaufen.
+	  */
+	~PersistentList()
+	{
+		while(first && first.unique())
+		{
+			// Der Rest wird mitgehalten und überlebt das freigegebene Glied
+			const boost::shared_ptr<const Cell> tail = first->tail;
+			first = tail;
+		}
+	}
+
+	/// Zuweisungs-Operator, gibt die bisherigen Glieder wie der Destruktor frei
+	PersistentList& operator=(const PersistentList& rhs)
+	{
+		const PersistentList old(*this);
+		first = rhs.first;
+		return *this;
+	}
+
+	/// Gibt aus, ob die Liste leer ist
+	bool empty() const
+	{
+		return !first;
+	}
+
+	/// Liefert das erste Element einer nicht leeren Liste
+	const T& front() const
+	{
+		return first->head;
+	}
+
+	/// Liefert die Liste ohne ihr erstes Element
+	PersistentList rest() const
+	{
+		return PersistentList(first->tail);
+	}
+
+	/// Liefert eine neue Liste mit vorangestelltem Element
+	PersistentList push(const T& head) const
+	{
+		return PersistentList(head,*this);
+	}
+
+	/// Iterator auf das erste Element
+	const_iterator begin() const
+	{
+		return const_iterator(first.get());
+	}
+
+	/// Iterator hinter das letzte Element
+	const_iterator end() const
+	{
+		return const_iterator();
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	boost::shared_ptr<const Cell> first;	///< Erstes Glied oder leer
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Konstruktor aus einem bestehenden Glied
+	explicit PersistentList(const boost::shared_ptr<const Cell>& cell)
+		: first(cell)
+	{
+	}
+};
+
+#endif
@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// server.hpp
+// Klasse ParserServer beantwortet Anfragen an einen geladenen Parser
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_SERVER_HPP__
+#define __WEGEL_TDBP_SERVER_HPP__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "tdbp.hpp"
+
+/// Server, der Grammatik und Lexikon einmal lädt und Sätze auf Anfrage parst
+/** Spricht ein zeilenweises Protokoll, entweder über Standardein- und
+  * -ausgabe oder mit beliebig vielen gleichzeitigen Clients über einen
+  * Unix-Socket, jeder in einem eigenen Thread. Jede Anfrage ist eine
+  * Zeile:
+  *
+  * - parse SATZ: parst den Satz mit den Einstellungen des Parsers
+  * - reload: liest Grammatik und Lexikon neu ein
+  * - quit: beendet die Verbindung
+  *
+  * Jede Antwort beginnt mit einer Kopfzeile. Bei Erfolg lautet sie
+  * "ok ZEILEN MIKROSEKUNDEN", danach folgen ZEILEN Zeilen mit Bäumen bzw.
+  * dem Ergebnis des gewählten Modus. Bei einem Fehler lautet sie
+  * "fehler MIKROSEKUNDEN MELDUNG" ohne weitere Zeilen. MIKROSEKUNDEN ist
+  * die Bearbeitungszeit der Anfrage im Server.
+  *
+  * Ein neu geladener Parser ersetzt den bisherigen erst, wenn er
+  * vollständig eingelesen ist. Anfragen, die gerade laufen, arbeiten mit
+  * dem bisherigen Parser zu Ende; bei einem Fehler bleibt er ganz in
+  * Gebrauch.
+  */
+class ParserServer
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor aus einem geladenen Parser und seinen Quelldateien
+	/** @param p Parser, dessen Einstellungen auch neu geladene übernehmen
+	    @param g Dateiname der Grammatik
+	    @param l Dateiname des Lexikons
+	    @param c Dateiname des Caches oder leer
+	  */
+	ParserServer(const boost::shared_ptr<TDBParser>& p, const std::string& g,
+	             const std::string& l, const std::string& c)
+		: parser(p), grammarfile(g), lexiconfile(l), cachefile(c)
+	{
+	}
+
+	/// Beantwortet Anfragen, bis die Eingabe endet oder quit kommt
+	/** @param in Anfragen
+	    @param out Antworten
+	  */
+	void serve(std::istream& in, std::ostream& out)
+	{
+		boost::shared_ptr<const TDBParser> used;
+		TDBParser::Session session;
+		std::string line;
+		while(std::getline(in,line))
+		{
+			if(!line.empty() && line[line.size()-1] == '\r')
+			{
+				line.erase(line.size()-1);
+			}
+			if(line == "quit")
+			{
+				break;
+			}
+			handle(line,used,session,out);
+			out.flush();
+		}
+	}
+
+	/// Nimmt Verbindungen an einem Unix-Socket an
+	/** Kehrt nur zurück, wenn der Socket nicht angelegt werden kann. Eine
+	  * vorhandene Datei gleichen Namens wird vorher entfernt.
+	    @param path Pfad des Sockets
+	    @param error Fehlermeldung
+	    @return Immer nein
+	  */
+	bool listen(const std::string& path, std::string& error)
+	{
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+		typedef boost::asio::local::stream_protocol Protocol;
+		try
+		{
+			boost::asio::io_service service;
+			std::remove(path.c_str());
+			Protocol::acceptor acceptor(service,Protocol::endpoint(path));
+			while(true)
+			{
+				boost::shared_ptr<Protocol::iostream> client(
+					new Protocol::iostream());
+				acceptor.accept(*client->rdbuf());
+				boost::thread(Connection(*this,client)).detach();
+			}
+		}
+		catch(const std::exception& e)
+		{
+			error = "Socket '"+path+"' kann nicht verwendet werden: "+e.what()+
+			        "\n";
+		}
+#else
+		error = "Unix-Sockets werden auf diesem System nicht unterstützt.\n";
+#endif
+		return false;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	/// Startfunktion des Threads einer Verbindung
+	struct Connection
+	{
+		ParserServer& server;	///< Geteilter Server
+		boost::shared_ptr<boost::asio::local::stream_protocol::iostream>
+			stream;				///< Verbindung zum Client
+
+		/// Konstruktor aus Server und Verbindung
+		Connection(ParserServer& s,
+		           const boost::shared_ptr<
+		               boost::asio::local::stream_protocol::iostream>& c)
+			: server(s), stream(c)
+		{
+		}
+
+		/// Beantwortet die Anfragen des Clients
+		void operator()()
+		{
+			server.serve(*stream,*stream);
+		}
+	};
+#endif
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	boost::shared_ptr<const TDBParser> parser;	///< Aktueller Parser
+	boost::mutex parser_lock;					///< Schützt parser
+	boost::mutex reload_lock;					///< Ein Neuladen zur Zeit
+	boost::mutex log_lock;						///< Schützt std::cerr
+	std::string grammarfile;					///< Dateiname der Grammatik
+	std::string lexiconfile;					///< Dateiname des Lexikons
+	std::string cachefile;						///< Dateiname des Caches
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Liefert den aktuellen Parser
+	boost::shared_ptr<const TDBParser> current()
+	{
+		boost::mutex::scoped_lock guard(parser_lock);
+		return parser;
+	}
+
+	/// Beantwortet eine Anfrage
+	/** @param line Anfrage
+	    @param used Parser, zu dem die Sitzung gehört
+	    @param session Sitzung der Verbindung
+	    @param out Antwort
+	  */
+	void handle(const std::string& line,
+	            boost::shared_ptr<const TDBParser>& used,
+	            TDBParser::Session& session, std::ostream& out)
+	{
+		const boost::posix_time::ptime start =
+			boost::posix_time::microsec_clock::universal_time();
+		std::string output;
+		std::string error;
+		bool success = false;
+		if(line.compare(0,6,"parse ") == 0 || line == "parse")
+		{
+			boost::shared_ptr<const TDBParser> now = current();
+			if(now != used)
+			{
+				// Nach einem Neuladen passt die Sitzung nicht mehr
+				used = now;
+				session = TDBParser::Session();
+			}
+			std::string log;
+			success = used->parse_string(line.size() > 6 ? line.substr(6) : "",
+			                             session,output,log);
+			if(!success)
+			{
+				error = log;
+			}
+			else if(!log.empty())
+			{
+				// Die Threads der Verbindungen schreiben sonst durcheinander
+				boost::mutex::scoped_lock guard(log_lock);
+				std::cerr << log;
+			}
+		}
+		else if(line == "reload")
+		{
+			success = reload(error);
+		}
+		else
+		{
+			error = "Unbekannte Anfrage: '"+line+"'";
+		}
+		const long micro = (boost::posix_time::microsec_clock::universal_time()-
+		                    start).total_microseconds();
+
+		if(success)
+		{
+			unsigned lines = 0;
+			for(std::string::const_iterator c = output.begin();
+			    c != output.end(); ++c)
+			{
+				lines += *c == '\n';
+			}
+			out << "ok " << lines << " " << micro << "\n" << output;
+		}
+		else
+		{
+			// Mehrzeilige Meldungen passen in die eine Kopfzeile
+			while(!error.empty() && error[error.size()-1] == '\n')
+			{
+				error.erase(error.size()-1);
+			}
+			for(std::string::iterator c = error.begin(); c != error.end(); ++c)
+			{
+				if(*c == '\n')
+				{
+					*c = ' ';
+				}
+			}
+			out << "fehler " << micro << " " << error << "\n";
+		}
+	}
+
+	/// Liest Grammatik und Lexikon neu ein und tauscht den Parser aus
+	/** @param error Fehlermeldung beim Einlesen
+	    @return Neuer Parser in Gebrauch ja/nein
+	  */
+	bool reload(std::string& error)
+	{
+		boost::mutex::scoped_lock reloading(reload_lock);
+		boost::shared_ptr<TDBParser> fresh =
+			TDBParser::load(grammarfile,lexiconfile,cachefile,error);
+		if(!fresh)
+		{
+			return false;
+		}
+		fresh->adopt_settings(*current());
+		boost::mutex::scoped_lock guard(parser_lock);
+		parser = fresh;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,419 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// symboltable.hpp
+// Klasse SymbolTable ordnet Strings kleine Ganzzahlen zu
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_SYMBOLTABLE_HPP__
+#define __WEGEL_TDBP_SYMBOLTABLE_HPP__
+
+#include <string>
+#include <ostream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include "globaltypes.hpp"
+#include "flatarray.hpp"
+
+/// Symboltabelle
+/** Vergibt beim Einlesen für jeden String einen fortlaufenden Index, mit
+  * dem der Parser anschließend arbeitet. Der String wird nur noch für die
+  * Ausgabe gebraucht.
+  *
+  * Alle Strings liegen hintereinander in einem Zeichenfeld, String i
+  * reicht von offsets[i] bis vor offsets[i+1]. Gesucht wird über eine
+  * Hashtabelle mit offener Adressierung, deren Plätze Index+1 oder 0 für
+  * frei enthalten. Da die Tabelle nur aus flachen Feldern besteht, kann
+  * sie ohne Umbau in eine Cache-Datei geschrieben und daraus eingeblendet
+  * werden.
+  *
+  * Ist die Tabelle fertig aufgebaut, ersetzt freeze() die Hashtabelle durch
+  * eine minimale perfekte Hashfunktion nach dem Verfahren Hash and
+  * Displace: Jeder String fällt in einen Eimer, und für jeden Eimer ist
+  * eine Verschiebung abgelegt, die seine Strings auf freie Plätze einer
+  * Tabelle mit genau einem Platz pro String verteilt. Eine Suche berechnet
+  * nur einen Hashwert und vergleicht genau einen String.
+  */
+class SymbolTable
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor einer leeren Tabelle
+	SymbolTable()
+	{
+		offsets.push_back(0);
+		slots.assign(16,0);
+		frozen = 0;
+	}
+
+	/// Liefert den Index eines Strings und legt ihn bei Bedarf neu an
+	/** @param name String
+	    @return Index
+	  */
+	SymbolId intern(const std::string& name)
+	{
+		if(frozen)
+		{
+			// Eingefrorene Tabelle wieder in eine Hashtabelle umbauen
+			SymbolId id;
+			if(find(name,id))
+			{
+				return id;
+			}
+			rehash(2*size()+2);
+		}
+		unsigned slot = probe(name.data(),name.size());
+		if(slots[slot] != 0)
+		{
+			return slots[slot]-1;
+		}
+		SymbolId id = size();
+		pool.append(name.begin(),name.end());
+		offsets.push_back(pool.size());
+		slots[slot] = id+1;
+		if(2*size() > slots.size())
+		{
+			rehash(2*slots.size());
+		}
+		return id;
+	}
+
+	/// Ersetzt die Hashtabelle durch eine minimale perfekte Hashfunktion
+	/** Danach belegt die Suche etwa fünf statt acht bis sechzehn Bytes pro
+	  * String. Weitere Aufrufe von intern() bauen die Hashtabelle wieder auf.
+	  */
+	void freeze()
+	{
+		if(frozen || size() == 0)
+		{
+			return;
+		}
+		std::vector<boost::uint64_t> hashes(size());
+		for(SymbolId id = 0; id < size(); ++id)
+		{
+			hashes[id] = hash64(pool.data()+offsets[id],name_length(id));
+		}
+		// Findet sich für einen Eimer keine Verschiebung, wird die Tabelle
+		// um einige freie Plätze vergrößert
+		unsigned places = size();
+		while(!build_perfect(hashes,size()/BUCKET_SIZE+1,places))
+		{
+			places += places/20+1;
+		}
+		frozen = 1;
+	}
+
+	/// Sucht den Index eines Strings
+	/** @param name String
+	    @param id Gefundener Index
+	    @return String bekannt ja/nein
+	  */
+	bool find(const std::string& name, SymbolId& id) const
+	{
+		return find(name.data(),name.size(),id);
+	}
+
+	/// Sucht den Index eines Strings, der nicht als std::string vorliegt
+	/** @param name Erstes Zeichen
+	    @param length Länge des Strings
+	    @param id Gefundener Index
+	    @return String bekannt ja/nein
+	  */
+	bool find(const char* name, const unsigned length, SymbolId& id) const
+	{
+		if(frozen)
+		{
+			return find_perfect(name,length,id);
+		}
+		unsigned slot = probe(name,length);
+		if(slots[slot] == 0)
+		{
+			return false;
+		}
+		id = slots[slot]-1;
+		return true;
+	}
+
+	/// Liefert den String zu einem Index
+	std::string name(const SymbolId id) const
+	{
+		return std::string(pool.data()+offsets[id],name_length(id));
+	}
+
+	/// Schreibt den String zu einem Index, ohne ihn zu kopieren
+	void write_name(std::ostream& out, const SymbolId id) const
+	{
+		out.write(pool.data()+offsets[id],name_length(id));
+	}
+
+	/// Hängt den String zu einem Index an einen Puffer an
+	void append_name(std::string& out, const SymbolId id) const
+	{
+		out.append(pool.data()+offsets[id],name_length(id));
+	}
+
+	/// Gibt die Länge des Strings zu einem Index aus
+	unsigned name_length(const SymbolId id) const
+	{
+		return offsets[id+1]-offsets[id];
+	}
+
+	/// Gibt die Anzahl der Strings aus
+	unsigned size() const
+	{
+		return offsets.size()-1;
+	}
+
+	/// Prüft die Felder einer eingeblendeten Tabelle
+	/** Alle Anfänge der Strings und alle Einträge der Hashtabelle müssen
+	  * innerhalb der Felder liegen, damit Nachschlagen und Ausgeben nie
+	  * daneben lesen. Im Cache stehen nur eingefrorene Tabellen.
+	    @return Tabelle gültig ja/nein
+	  */
+	bool valid() const
+	{
+		if(frozen != 1 || offsets.empty() || offsets[0] != 0 ||
+		   slots.empty() || displacements.empty())
+		{
+			return false;
+		}
+		for(unsigned i = 1; i < offsets.size(); ++i)
+		{
+			if(offsets[i] < offsets[i-1])
+			{
+				return false;
+			}
+		}
+		if(offsets[offsets.size()-1] > pool.size())
+		{
+			return false;
+		}
+		for(unsigned i = 0; i < slots.size(); ++i)
+		{
+			if(slots[i] > size())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Übergibt alle Felder der Tabelle an einen Besucher
+	/** Dient dem Schreiben und Einblenden der Cache-Datei.
+	    @param visitor Funktionsobjekt, das mit jedem Feld aufgerufen wird
+	  */
+	template<typename Visitor>
+	void visit(Visitor& visitor)
+	{
+		visitor(frozen);
+		visitor(pool);
+		visitor(offsets);
+		visitor(slots);
+		visitor(displacements);
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Mittlere Anzahl der Strings pro Eimer der perfekten Hashfunktion
+	enum {BUCKET_SIZE = 4};
+
+	/// Versuche pro Eimer, bevor die Tabelle vergrößert wird
+	enum {MAX_DISPLACEMENT = 1 << 16};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	unsigned frozen;					///< Perfekte Hashfunktion ja/nein
+	FlatArray<char> pool;				///< Alle Strings hintereinander
+	FlatArray<unsigned> offsets;		///< Index -> Beginn des Strings
+	FlatArray<SymbolId> slots;			///< Hashtabelle, Index+1 oder 0
+	FlatArray<unsigned> displacements;	///< Eimer -> Verschiebung
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Berechnet den Hashwert eines Strings (FNV-1a)
+	static unsigned hash(const char* name, const unsigned length)
+	{
+		unsigned h = 2166136261u;
+		for(unsigned i = 0; i < length; ++i)
+		{
+			h ^= static_cast<unsigned char>(name[i]);
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	/// Berechnet den Hashwert eines Strings für die perfekte Hashfunktion
+	static boost::uint64_t hash64(const char* name, const unsigned length)
+	{
+		boost::uint64_t h = 14695981039346656037ULL;
+		for(unsigned i = 0; i < length; ++i)
+		{
+			h ^= static_cast<unsigned char>(name[i]);
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	/// Berechnet den Platz eines Hashwertes bei gegebener Verschiebung
+	static unsigned perfect_slot(const boost::uint64_t h,
+	                             const unsigned displacement,
+	                             const unsigned places)
+	{
+		boost::uint64_t x = h ^ (displacement*0x9e3779b97f4a7c15ULL);
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		return static_cast<unsigned>(x % places);
+	}
+
+	/// Sucht einen String über die perfekte Hashfunktion
+	bool find_perfect(const char* name, const unsigned length,
+	                  SymbolId& id) const
+	{
+		const boost::uint64_t h = hash64(name,length);
+		const unsigned d = displacements[(h >> 32) % displacements.size()];
+		const SymbolId entry = slots[perfect_slot(h,d,slots.size())];
+		if(entry == 0 || name_length(entry-1) != length ||
+		   std::memcmp(pool.data()+offsets[entry-1],name,length) != 0)
+		{
+			return false;
+		}
+		id = entry-1;
+		return true;
+	}
+
+	/// Sucht Verschiebungen für alle Eimer der perfekten Hashfunktion
+	/** Große Eimer werden zuerst verteilt, solange noch viele Plätze frei
+	  * sind.
+	    @param hashes Hashwerte aller Strings
+	    @param buckets Anzahl der Eimer
+	    @param places Anzahl der Plätze, mindestens die Anzahl der Strings
+	    @return Verschiebungen für alle Eimer gefunden ja/nein
+	  */
+	bool build_perfect(const std::vector<boost::uint64_t>& hashes,
+	                   const unsigned buckets, const unsigned places)
+	{
+		// Strings nach Eimern sortieren
+		std::vector<unsigned> first(buckets+1,0);
+		for(SymbolId id = 0; id < hashes.size(); ++id)
+		{
+			++first[(hashes[id] >> 32) % buckets+1];
+		}
+		std::vector<std::pair<unsigned,unsigned> > order;
+		for(unsigned b = 0; b < buckets; ++b)
+		{
+			if(first[b+1] > 0)
+			{
+				order.push_back(std::make_pair(first[b+1],b));
+			}
+			first[b+1] += first[b];
+		}
+		std::vector<SymbolId> members(hashes.size());
+		std::vector<unsigned> fill(first.begin(),first.end()-1);
+		for(SymbolId id = 0; id < hashes.size(); ++id)
+		{
+			members[fill[(hashes[id] >> 32) % buckets]++] = id;
+		}
+		std::sort(order.rbegin(),order.rend());
+
+		std::vector<SymbolId> table(places,0);
+		std::vector<unsigned> shift(buckets,0);
+		std::vector<unsigned> taken;
+		for(unsigned i = 0; i < order.size(); ++i)
+		{
+			const unsigned b = order[i].second;
+			unsigned d = 0;
+			for(;; ++d)
+			{
+				if(d == MAX_DISPLACEMENT)
+				{
+					return false;
+				}
+				taken.clear();
+				unsigned m = first[b];
+				for(; m < first[b+1]; ++m)
+				{
+					unsigned slot = perfect_slot(hashes[members[m]],d,places);
+					if(table[slot] != 0 ||
+					   std::find(taken.begin(),taken.end(),slot) != taken.end())
+					{
+						break;
+					}
+					taken.push_back(slot);
+				}
+				if(m == first[b+1])
+				{
+					break;
+				}
+			}
+			for(unsigned k = 0; k < taken.size(); ++k)
+			{
+				table[taken[k]] = members[first[b]+k]+1;
+			}
+			shift[b] = d;
+		}
+		slots.clear();
+		slots.append(table.begin(),table.end());
+		displacements.clear();
+		displacements.append(shift.begin(),shift.end());
+		return true;
+	}
+
+	/// Sucht den Platz eines Strings oder den freien Platz für ihn
+	unsigned probe(const char* name, const unsigned length) const
+	{
+		const unsigned mask = slots.size()-1;
+		unsigned slot = hash(name,length) & mask;
+		while(slots[slot] != 0)
+		{
+			const SymbolId id = slots[slot]-1;
+			if(name_length(id) == length &&
+			   std::memcmp(pool.data()+offsets[id],name,length) == 0)
+			{
+				break;
+			}
+			slot = (slot+1) & mask;
+		}
+		return slot;
+	}
+
+	/// Baut die Hashtabelle mit mindestens der gegebenen Größe neu auf
+	void rehash(const unsigned capacity)
+	{
+		unsigned places = 16;
+		while(places < capacity)
+		{
+			places *= 2;
+		}
+		frozen = 0;
+		displacements.clear();
+		slots.assign(places,0);
+		for(SymbolId id = 0; id < size(); ++id)
+		{
+			slots[probe(pool.data()+offsets[id],name_length(id))] = id+1;
+		}
+	}
+};
+
+#endif
@@ -24,13 +24,28 @@
 #include <sstream>
 #include <string>
 #include <set>
-#include <stack>
 #include <map>
+#include <vector>
+#include <deque>
+#include <algorithm>
 #include <boost/unordered_map.hpp>
-#include <boost/tokenizer.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "globaltypes.hpp"
 #include "dcgreader.hpp"
+#include "compiledgrammar.hpp"
+#include "lexiconentries.hpp"
+#include "tokenizer.hpp"
+#include "grammarcache.hpp"
 #include "wishtree.hpp"
+#include "persistentlist.hpp"
+#include "forest.hpp"
+#include "earley.hpp"
+#include "cyk.hpp"
+#include "threadpool.hpp"
+#include "fingerprint.hpp"
 
 /// Top-Down-Backtracking-Parser
 /** Parser, der einen String tokenisiert, dafür auf Grundlage einer separierten
@@ -44,78 +59,678 @@ class TDBParser
 	////////////////////////////////////////////////////////////////////////////
 	// Typen
 
-	/// Menge von Symbolen
-	typedef std::set<Symbol> SymbolSet;
+	/// Unveränderlicher Stapel mit Symbolindizes
+	/** Stapel, die aus demselben Stapel hervorgehen, teilen sich dessen
+	  * Glieder.
+	  */
+	typedef PersistentList<SymbolId> SymbolStack;
+
+	/// Kette der Symbole, die gerade linksexpandiert werden
+	typedef PersistentList<SymbolId> SymbolChain;
+
+	/// Teilsuche, die im parallelen Suchmodus als Aufgabe verteilt wird
+	/** Enthält die Parameter eines Aufrufs von parse_iterative.
+	  */
+	struct SearchTask
+	{
+		TokenIdList::const_iterator input_pos;	///< Position im Input
+		SymbolStack to_be_expanded;		///< Stapel zu expandierender Symbole
+		unsigned pending;				///< Mindestlänge des Stapels
+		SymbolChain left_expanding;		///< Linksexpandierte Symbole
+		WishTree tree;					///< Bisher aufgebauter Baum
+		unsigned depth;					///< Anzahl Expansionen bis hierher
+	};
+
+	/// Threadpool für Teilsuchen
+	typedef WorkStealingPool<SearchTask> SearchPool;
+
+	/// Auswahlpunkt der iterativen Suche
+	/** Hält für ein expandiertes Nichtterminal alles, um beim Backtracking
+	  * die nächste Regel zu probieren. Stapel, Kette und Baum teilen sich
+	  * ihre Glieder mit den tieferen Auswahlpunkten.
+	  */
+	struct ChoicePoint
+	{
+		TokenIdList::const_iterator input_pos;	///< Position im Input
+		SymbolId symbol;				///< Expandiertes Symbol
+		SymbolStack rest;				///< Stapel unter dem Symbol
+		unsigned rest_yield;			///< Mindestlänge des Rests
+		SymbolChain chain;				///< Linkskette mit dem Symbol
+		WishTree tree;					///< Baum vor der Expansion
+		const BitWord* categories;		///< Kategorien des aktuellen Tokens
+		CompiledGrammar::RuleId rule;	///< Nächste zu probierende Regel
+		unsigned entry;					///< Eintrag der Tabelle oder NO_ENTRY
+		bool reuse;						///< Ergebnisse statt Regeln probieren
+		unsigned next;					///< Nächstes Ergebnis beim Wiederverwenden
+	};
 
-	/// Map mit Produktionsregeln Symbol -> Liste von rechten Regelseiten
-	typedef boost::unordered_map<Symbol,SymbolListList> Grammar;
+	/// Stapel der Auswahlpunkte
+	typedef std::vector<ChoicePoint> ChoiceStack;
+
+	/// Abgeschlossene Expansion eines Nichtterminals in der Tabelle
+	struct MemoResult
+	{
+		unsigned end;						///< Position hinter dem Teilbaum
+		const WishTree::Segment* segment;	///< Schritte des Teilbaums
+		SymbolChain chain;					///< Linkskette am Ende
+
+		/// Gleichheits-Operator nach Ende und Teilbaum
+		bool operator==(const MemoResult& rhs) const
+		{
+			return end == rhs.end && *segment == *rhs.segment;
+		}
+
+		/// Hashfunktion für boost::unordered_set
+		friend std::size_t hash_value(const MemoResult& r)
+		{
+			std::size_t seed = 0;
+			boost::hash_combine(seed,r.end);
+			boost::hash_combine(seed,r.segment->fingerprint());
+			return seed;
+		}
+	};
+
+	/// Eintrag der Tabelle für ein Nichtterminal an einer Position
+	/** Hält alle Expansionen, die bei einer vollständigen Suche mit der
+	  * Grenze limit gefunden wurden, in der Reihenfolge ihres Auffindens.
+	  * Gleiche Teilbäume mit gleichem Ende, etwa aus gleichlautenden
+	  * Regeln, stehen nur einmal darin, da sie nur gleiche Bäume ergäben.
+	  * Welche Expansionen die Linksrekursionsprüfung abschneidet, hängt von
+	  * der Linkskette vor dem Symbol ab; sie gehört daher zum Schlüssel,
+	  * und Einträge mit gleichem Symbol und gleicher Position, aber anderer
+	  * Kette sind über next verkettet.
+	  */
+	struct MemoEntry
+	{
+		unsigned start;						///< Position des Nichtterminals
+		unsigned limit;						///< Größtes zulässiges Ende
+		bool tail;							///< Nur Expansionen bis zum Ende
+		bool complete;						///< Suche vollständig ja/nein
+		SymbolChain chain;					///< Linkskette vor dem Symbol
+		unsigned next;						///< Eintrag mit anderer Kette
+		unsigned outer;						///< Eintrag der eingesparten Marke
+		WishTree tree;						///< Baum vor der Expansion
+		std::vector<MemoResult> results;	///< Gefundene Expansionen
+		boost::unordered_set<MemoResult> distinct;	///< Zum Nachschlagen
+	};
+
+	/// Position und Symbol -> erster Eintrag der Tabelle
+	typedef boost::unordered_map<std::pair<unsigned,SymbolId>,unsigned> MemoIndex;
+
+	/// Zustand für das Parsen eines Satzes
+	/** Enthält alles, was sich beim Parsen ändert. Grammatik und Lexikon
+	  * sind dagegen unveränderlich und werden von allen Threads geteilt,
+	  * von denen jeder seinen eigenen Kontext hat.
+	  */
+	struct ParseContext
+	{
+		TreeSet trees;					///< Menge der gefundenen Parsebäume
+		WishTreeSet found;				///< Vom Backtracking gefundene Bäume
+		std::ostringstream log;			///< Warnungen des Durchlaufs
+		ParseForest forest;				///< Wald der Chart-Verfahren
+		boost::uint64_t forest_count;	///< Im Wald gezählte Bäume
+		ChoiceStack choices;			///< Auswahlpunkte des Backtrackings
+		WishTree::Writer writer;		///< Puffer für die Ausgabe der Bäume
+		boost::shared_ptr<EarleyParser> earley;	///< Earley-Parser, falls gewählt
+		boost::shared_ptr<CYKParser> cyk;		///< CYK-Parser, falls gewählt
+		TokenIdList::const_iterator input_begin;	///< Anfang des Inputs
+		std::vector<BitWord> lookahead;	///< Position -> Kategorien des Tokens
+		SearchPool* pool;				///< Pool im parallelen Suchmodus oder 0
+		unsigned worker;				///< Index des Threads im Pool
+		unsigned depth;					///< Anzahl Expansionen bis hierher
+		std::ostream* stream;			///< Ziel im Streaming-Modus oder 0
+		FingerprintSet fingerprints;	///< Eigene Abdrücke gefundener Bäume
+		boost::mutex lock;				///< Eigener Schutz der Abdrücke
+		volatile bool stopped;			///< Eigenes Abbruchsignal
+		FingerprintSet* seen;			///< Geteilte oder eigene Abdrücke
+		boost::mutex* stream_lock;		///< Schützt stream und seen
+		volatile bool* stop;			///< Suche beenden, Ergebnis steht fest
+		MemoIndex memo_index;				///< Position, Symbol -> Eintrag
+		std::vector<MemoEntry> memo;		///< Einträge der Tabelle
+		std::deque<WishTree::Segment> segments;	///< Teilbäume der Tabelle
+		bool memo_full;						///< Tabelle hat ihre Größe erreicht
+
+		/// Konstruktor eines Kontexts für die sequentielle Suche
+		ParseContext()
+		{
+			pool = 0;
+			worker = 0;
+			depth = 0;
+			stream = 0;
+			stopped = false;
+			seen = &fingerprints;
+			stream_lock = &lock;
+			stop = &stopped;
+			memo_full = false;
+			forest_count = 0;
+		}
 
-	/// Map mit Bottom-Up-Lexikonregeln Terminal -> Menge von Nichtterminalen
-	typedef boost::unordered_map<Token,SymbolSet> Lexicon;
+		/// Setzt die Ergebnisse für den nächsten Satz zurück
+		void reset()
+		{
+			trees.clear();
+			found.clear();
+			log.str("");
+			forest.clear();
+			forest_count = 0;
+			fingerprints.clear();
+			stopped = false;
+			memo_index.clear();
+			memo.clear();
+			segments.clear();
+			memo_full = false;
+		}
+	};
+
+	/// Liste der Kontexte, einer pro Thread
+	typedef std::vector<boost::shared_ptr<ParseContext> > ContextList;
+
+	/// Ergebnis eines Satzes im Stapelbetrieb
+	struct SentenceResult
+	{
+		std::string output;	///< Kopfzeile und Bäume
+		std::string log;	///< Meldungen und Warnungen
+		bool skipped;		///< Wegen unbekannter Wörter übersprungen
+
+		/// Konstruktor eines leeren Ergebnisses
+		SentenceResult()
+		{
+			skipped = false;
+		}
+	};
+
+	/// Aufgabe des Threadpools im Stapelbetrieb: parse einen Satz
+	struct CorpusJob
+	{
+		const TDBParser& parser;				///< Geteilter Parser
+		ContextList& contexts;					///< Kontext pro Thread
+		const std::vector<std::string>& sentences;	///< Sätze des Blocks
+		std::vector<SentenceResult>& results;	///< Ergebnisse des Blocks
+		unsigned first;							///< Nummer des ersten Satzes
+
+		/// Konstruktor aus den geteilten Daten eines Blocks
+		CorpusJob(const TDBParser& p, ContextList& c,
+		          const std::vector<std::string>& s,
+		          std::vector<SentenceResult>& r, const unsigned f)
+			: parser(p), contexts(c), sentences(s), results(r), first(f)
+		{
+		}
+
+		/// Parst Satz i des Blocks mit dem Kontext des Threads
+		void operator()(const unsigned worker, const unsigned i)
+		{
+			std::ostringstream out;
+			parser.parse_sentence(first+i,sentences[i],*contexts[worker],out,
+			                      results[i]);
+			results[i].output = out.str();
+		}
+	};
+	friend struct CorpusJob;
+
+	/// Aufgabe des Threadpools im parallelen Suchmodus: eine Teilsuche
+	struct SearchJob
+	{
+		const TDBParser& parser;			///< Geteilter Parser
+		ContextList& contexts;				///< Kontext pro Thread
+		TokenIdList::const_iterator input_end;	///< Ende des Inputs
+
+		/// Konstruktor aus den geteilten Daten eines Satzes
+		SearchJob(const TDBParser& p, ContextList& c,
+		          const TokenIdList::const_iterator e)
+			: parser(p), contexts(c), input_end(e)
+		{
+		}
+
+		/// Führt eine Teilsuche mit dem Kontext des Threads aus
+		void operator()(const unsigned worker, const SearchTask& task)
+		{
+			ParseContext& context = *contexts[worker];
+			context.worker = worker;
+			context.depth = task.depth;
+			parser.parse_iterative(task.input_pos,input_end,task.to_be_expanded,
+			                       task.pending,task.left_expanding,task.tree,
+			                       context);
+		}
+	};
+	friend struct SearchJob;
+
+	/// Grammatik oder Abschnitt des Lexikons, den ein Thread einliest
+	struct SourcePart
+	{
+		const std::string* filename;	///< Dateiname für Fehlermeldungen
+		bool lexicon;					///< Abschnitt des Lexikons ja/nein
+		const char* begin;				///< Erstes Zeichen
+		const char* end;				///< Zeichen hinter dem Abschnitt
+		unsigned line;					///< Zeile des ersten Zeichens
+		unsigned column;				///< Spalte des ersten Zeichens
+		Grammar rules;					///< Gelesene Produktionsregeln
+		LexiconEntries entries;			///< Gelesene Lexikonregeln
+		std::string error;				///< Fehlermeldung oder leer
+	};
 
-	/// Stapel mit Symbolinstanzen
-	typedef std::stack<SymbolInstance> SymbolStack;
+	/// Liste der Teile, die parallel eingelesen werden
+	typedef std::vector<SourcePart> SourcePartList;
 
-	/// Menge von Bäumen
-	typedef std::set<std::string> TreeSet;
+	/// Threadpool zum Einlesen, eine Aufgabe ist der Index eines Teils
+	typedef WorkStealingPool<unsigned> SourcePool;
+
+	/// Aufgabe des Threadpools beim Einlesen: ein Teil der Quelldateien
+	struct LoadJob
+	{
+		SourcePartList& parts;	///< Alle Teile
+
+		/// Konstruktor aus der Liste der Teile
+		LoadJob(SourcePartList& p)
+			: parts(p)
+		{
+		}
+
+		/// Liest einen Teil mit einem eigenen Automaten ein
+		void operator()(const unsigned, const unsigned index)
+		{
+			SourcePart& part = parts[index];
+			DCGReader reader(*part.filename,part.begin,part.end,part.lexicon,
+			                 part.line,part.column);
+			if(part.lexicon)
+			{
+				init_lexicon_prolog(reader,part.entries);
+			}
+			else
+			{
+				init_grammar_prolog(reader,part.rules);
+			}
+			part.error = reader.error();
+		}
+	};
+	friend struct LoadJob;
+
+	/// Mindestgröße eines Lexikonabschnitts in Bytes
+	enum {MIN_CHUNK = 1 << 20};
+
+	/// Bis zu dieser Anzahl von Expansionen werden Alternativen verteilt
+	enum {FORK_DEPTH = 8};
+
+	/// Mindestzahl übriger Tokens, damit sich eine Teilsuche lohnt
+	enum {FORK_MIN_TOKENS = 4};
+
+	/// Bit, das auf dem Stapel das Ende einer Expansion markiert
+	/** Die übrigen Bits sind der Index des Eintrags der Tabelle.
+	  */
+	enum {MEMO_MARK = 0x80000000u};
+
+	/// Kein Eintrag der Tabelle
+	enum {NO_ENTRY = 0xffffffffu};
+
+	/// Höchstzahl von Einträgen und Ergebnissen der Tabelle pro Satz
+	/** Danach werden keine neuen Expansionen mehr festgehalten, und die
+	  * Suche läuft ohne Tabelle weiter.
+	  */
+	enum {MEMO_LIMIT = 1 << 19};
 
 	public:
 
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Verfahren, mit denen die Bäume gesucht werden
+	enum Engine {BACKTRACKING, EARLEY, CYK};
+
+	/// Gewünschtes Ergebnis pro Satz
+	/** ALL: alle Bäume, FIRST: die ersten n gefundenen Bäume, COUNT: nur
+	  * die Anzahl der Bäume, EXISTS: nur, ob es einen Baum gibt (1 oder 0),
+	  * FOREST: der gepackte Parsewald statt der Bäume.
+	  */
+	enum Mode {ALL, FIRST, COUNT, EXISTS, FOREST};
+
+	/// Sitzung eines Aufrufers, der nacheinander einzelne Sätze parst
+	/** Hält den Kontext mit den Tabellen der Chart-Parser und den Puffern
+	  * des Backtrackings von Satz zu Satz, damit sie nicht für jeden Satz
+	  * neu angelegt werden. Der Kontext entsteht beim ersten Satz.
+	  */
+	class Session
+	{
+		friend class TDBParser;
+		boost::shared_ptr<ParseContext> context;	///< Kontext oder leer
+	};
+
+	/// Laufzeiten der Schritte eines Satzes in Mikrosekunden
+	/** Ohne Streaming sind Suche und Ausgabe getrennt: Die Suche sammelt
+	  * die Bäume, erst die Ausgabe baut sie als Strings auf.
+	  */
+	struct Timings
+	{
+		long tokenize;	///< Zerlegen in Tokens und Nachschlagen im Lexikon
+		long search;	///< Suche der Bäume
+		long serialize;	///< Ausgabe der Bäume bzw. des Ergebnisses
+	};
+
 	////////////////////////////////////////////////////////////////////////////
 	// Öffentliche Funktionen
 
 	/// Konstruktor aus einer separierten Grammatik im Prolog-DCG-Format
-	/** Liest Grammatik und Lexikon ein und erstellt daraus interne
-	  * Repräsentationen.
+	/** Liest Grammatik und Lexikon ein und übersetzt sie in eine interne
+	  * Repräsentation mit Symbolindizes. Ist ein Cache angegeben und passt
+	  * er zu den Quelldateien, wird die übersetzte Grammatik stattdessen aus
+	  * ihm eingeblendet; sonst wird er nach dem Übersetzen neu geschrieben.
+	    @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @param e Verfahren, mit dem geparst wird
+	    @param cachefile Dateiname des Caches oder leer
+	  */
+	TDBParser(const std::string grammarfile, const std::string lexiconfile,
+	          const Engine e = BACKTRACKING, const std::string cachefile = "")
+	{
+		std::string error;
+		if(!load_grammar(grammarfile,lexiconfile,cachefile,error))
+		{
+			// Fehlermeldung und Abbruch
+			std::cerr << error;
+			exit(1);
+		}
+
+		engine = e;
+		streaming = false;
+		memo = false;
+		mode = ALL;
+		limit = 0;
+	}
+
+	/// Lädt einen Parser, ohne das Programm bei Fehlern zu beenden
+	/** Für langlebige Prozesse wie den Server, die nach einer fehlerhaften
+	  * Grammatik mit dem bisherigen Parser weiterarbeiten.
 	    @param grammarfile Dateiname der Grammatik
 	    @param lexiconfile Dateiname des Lexikons
+	    @param cachefile Dateiname des Caches oder leer
+	    @param error Fehlermeldung beim Einlesen
+	    @return Neuer Parser mit Standardeinstellungen oder leer bei Fehler
 	  */
-	TDBParser(const std::string grammarfile, const std::string lexiconfile)
+	static boost::shared_ptr<TDBParser> load(const std::string& grammarfile,
+	                                         const std::string& lexiconfile,
+	                                         const std::string& cachefile,
+	                                         std::string& error)
 	{
-		init_grammar_prolog(grammarfile);
-		init_lexicon_prolog(lexiconfile);
+		boost::shared_ptr<TDBParser> parser(new TDBParser());
+		if(!parser->load_grammar(grammarfile,lexiconfile,cachefile,error))
+		{
+			parser.reset();
+		}
+		return parser;
+	}
+
+	/// Übersetzt Grammatik und Lexikon nur in eine Cache-Datei
+	/** @param cachefile Dateiname des Caches
+	    @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @return Cache geschrieben ja/nein
+	  */
+	static bool build_cache(const std::string& cachefile,
+	                        const std::string& grammarfile,
+	                        const std::string& lexiconfile)
+	{
+		// Der Kopf hält den Stand der Quelldateien vor dem Einlesen fest
+		GrammarCache::Header head;
+		const bool stamped = GrammarCache::header(grammarfile,lexiconfile,head);
+		CompiledGrammar compiled;
+		std::string error;
+		if(!compile_sources(grammarfile,lexiconfile,compiled,error))
+		{
+			// Fehlermeldung und Abbruch
+			std::cerr << error;
+			exit(1);
+		}
+		return stamped && GrammarCache::save(cachefile,head,compiled);
+	}
+
+	/// Wählt das gewünschte Ergebnis pro Satz
+	/** Außer im Modus ALL bricht das Backtracking ab, sobald das Ergebnis
+	  * feststeht. In den Modi COUNT und EXISTS werden die Bäume nie als
+	  * String aufgebaut: Das Backtracking zählt sie über ihre
+	  * Fingerabdrücke, Earley und CYK zählen sie im gepackten Wald.
+	    @param m Modus
+	    @param n Anzahl der Bäume im Modus FIRST
+	  */
+	void set_mode(const Mode m, const unsigned n = 0)
+	{
+		mode = m;
+		limit = n;
+	}
+
+	/// Schaltet den Streaming-Modus ein oder aus
+	/** Im Streaming-Modus wird jeder Baum geschrieben, sobald er gefunden
+	  * ist, statt alle Bäume zu sammeln und sortiert zu speichern.
+	  * Doppelte Bäume werden über ihre Fingerabdrücke unterdrückt.
+	    @param s Streaming ja/nein
+	  */
+	void set_streaming(const bool s)
+	{
+		streaming = s;
+	}
+
+	/// Schaltet die Tabelle abgeschlossener Expansionen ein oder aus
+	/** Mit Tabelle merkt sich das Backtracking für jedes Nichtterminal und
+	  * jede Startposition, an welchen Positionen und mit welchen Teilbäumen
+	  * seine Expansionen enden. Trifft die Suche später an derselben
+	  * Position wieder auf das Nichtterminal, übernimmt sie diese
+	  * Ergebnisse, statt den Teilbaum erneut abzuleiten. Bäume und ihre
+	  * Reihenfolge bleiben gleich. Die Tabelle ist pro Satz auf MEMO_LIMIT
+	  * Einträge und Teilbäume begrenzt; die Suche läuft mit ihr immer in
+	  * einem Thread.
+	    @param m Tabelle ja/nein
+	  */
+	void set_memo(const bool m)
+	{
+		memo = m;
+	}
+
+	/// Übernimmt Verfahren, Modus und Tokenisierung eines anderen Parsers
+	/** @param other Parser, dessen Einstellungen übernommen werden
+	  */
+	void adopt_settings(const TDBParser& other)
+	{
+		engine = other.engine;
+		streaming = other.streaming;
+		memo = other.memo;
+		mode = other.mode;
+		limit = other.limit;
+		tokenizer = other.tokenizer;
+	}
+
+	/// Legt die Regeln zum Zerlegen der Sätze in Tokens fest
+	/** @param t Tokenisierer mit den gewünschten Regeln
+	  */
+	void set_tokenizer(const Tokenizer& t)
+	{
+		tokenizer = t;
 	}
 
 	/// Parst einen Satz und speichert die Bäume in einer Datei
 	/** Tokenisiert den Satz, parst ihn komplett mithilfe von Backtracking
-	  * und speichert alle gefundenen Bäume in der angegebenen Datei.
+	  * oder einem Chart-Verfahren und speichert alle gefundenen Bäume in der
+	  * angegebenen Datei.
+	  *
+	  * Mit mehr als einem Thread werden beim Backtracking die alternativen
+	  * Regeln nahe der Wurzel des Suchbaums als Aufgaben auf einen
+	  * Threadpool verteilt; tiefer und bei wenig übrigem Input wird
+	  * sequentiell gesucht. Jeder Thread sammelt Bäume in seinem Kontext,
+	  * die Mengen werden am Ende vereinigt.
 	    @param sentence Satz
 	    @param outfile Speicherziel für die Bäume
+	    @param threads Anzahl der Threads
 	  */
-	void parse(const std::string sentence, const std::string outfile)
+	void parse(const std::string sentence, const std::string outfile,
+	           const unsigned threads = 1) const
 	{
 		// Initialisiere Werte
-		init_parse();
+		ParseContext context;
+		init_context(context);
+
+		// Tokenisiere Input und schlage dabei die Indizes der Tokens im
+		// Lexikon nach
+		TokenIdList ids;
+		std::string error;
+		if(!tokenizer.run(sentence,grammar.token_table(),ids,error))
+		{
+			// Token nicht im Lexikon, Abbruch
+			std::cerr << error << "\n";
+			exit(1);
+		}
+
+		std::ofstream outstream;
+		outstream.open(outfile.c_str());
+		if(streaming)
+		{
+			// Schreibe die Bäume direkt beim Finden in die Datei
+			context.stream = &outstream;
+		}
 
-		// Tokenisiere Input
-		TokenList input;
-		boost::tokenizer<> tok(sentence);
-		for(boost::tokenizer<>::iterator i = tok.begin(); i != tok.end(); ++i)
+		// Suche die Bäume
+		if(threads > 1 && engine == BACKTRACKING && mode != FOREST && !memo &&
+		   !ids.empty())
 		{
-			input.push_back(*i);
+			parse_parallel(ids,context,threads);
 		}
+		else
+		{
+			parse_tokens(ids,context);
+		}
+		std::cerr << context.log.str();
 
-		// Prüfe, ob alle Tokens im Lexikon stehen
-		check_tokens(input);
+		// Speichere die gefundenen Bäume bzw. das Ergebnis
+		if(outstream.is_open())
+		{
+			write_result(outstream,context);
+		}
+	}
+
+	/// Parst einen Satz und liefert das Ergebnis als String
+	/** Für Aufrufer wie den Server, die viele einzelne Sätze parsen, ohne
+	  * eine Datei zu schreiben. Das Ergebnis entspricht dem Inhalt, den
+	  * parse() in die Datei schreibt. Die Sitzung hält den Kontext über
+	  * mehrere Sätze; sie darf nur mit diesem Parser und nie von zwei
+	  * Threads gleichzeitig benutzt werden.
+	    @param sentence Satz
+	    @param session Sitzung des Aufrufers
+	    @param output Bäume bzw. Ergebnis, ein Eintrag pro Zeile
+	    @param log Warnungen beim Parsen
+	    @param timings Laufzeiten der einzelnen Schritte oder 0
+	    @return Alle Tokens bekannt ja/nein, sonst steht die Meldung in log
+	  */
+	bool parse_string(const std::string& sentence, Session& session,
+	                  std::string& output, std::string& log,
+	                  Timings* timings = 0) const
+	{
+		if(!session.context)
+		{
+			session.context.reset(new ParseContext());
+			init_context(*session.context);
+		}
+		ParseContext& context = *session.context;
 
-		// Iteriere über Input
-		TokenList::const_iterator input_pos = input.begin();
+		boost::posix_time::ptime start =
+			boost::posix_time::microsec_clock::universal_time();
+		TokenIdList ids;
+		if(!tokenizer.run(sentence,grammar.token_table(),ids,log))
+		{
+			return false;
+		}
+		lap(start,timings ? &timings->tokenize : 0);
+		std::ostringstream out;
+		context.reset();
+		context.stream = streaming ? &out : 0;
+		parse_tokens(ids,context);
+		context.stream = 0;
+		lap(start,timings ? &timings->search : 0);
+		write_result(out,context);
+		output = out.str();
+		lap(start,timings ? &timings->serialize : 0);
+		log = context.log.str();
+		return true;
+	}
 
-		// Instantiiere Startsymbol
-		SymbolInstance start = new_si(Symbol("s"));
+	/// Parst ein Korpus mit einem Satz pro Zeile
+	/** Parst alle Sätze mit der einmal geladenen Grammatik. Vor den Bäumen
+	  * jedes Satzes wird eine Kopfzeile "% <Nummer>: <Satz>" ausgegeben.
+	  * Sätze mit unbekannten Wörtern werden übersprungen und gemeldet, leere
+	  * Zeilen haben keine Bäume.
+	  *
+	  * Mit mehreren Threads wird das Korpus blockweise gelesen. Die Sätze
+	  * eines Blocks werden über einen Threadpool mit Work-Stealing
+	  * verteilt, jeder Thread hat einen eigenen Kontext, die Grammatik
+	  * teilen alle. Ausgaben und Meldungen erscheinen in der Reihenfolge der
+	  * Eingabe. Mit einem Thread wird jeder Satz sofort ausgegeben.
+	    @param in Eingabe mit den Sätzen
+	    @param out Ausgabe für die Bäume
+	    @param threads Anzahl der Threads
+	    @return Anzahl übersprungener Sätze
+	  */
+	unsigned parse_corpus(std::istream& in, std::ostream& out,
+	                      const unsigned threads = 1) const
+	{
+		WorkStealingPool<unsigned> pool(threads);
+		ContextList contexts(pool.size());
+		for(unsigned w = 0; w < pool.size(); ++w)
+		{
+			contexts[w].reset(new ParseContext());
+			init_context(*contexts[w]);
+		}
 
-		// Instantiiere Stapel zu expandierender Symbole mit Startsymbol
-		SymbolStack to_be_expanded;
-		to_be_expanded.push(start);
+		unsigned skipped = 0;
+		unsigned first = 1;
+		std::string line;
+		if(pool.size() == 1)
+		{
+			// Ein Thread: Jeden Satz direkt parsen und ausgeben
+			for(; std::getline(in,line); ++first)
+			{
+				SentenceResult result;
+				parse_sentence(first,line,*contexts[0],out,result);
+				std::cerr << result.log;
+				if(result.skipped)
+				{
+					++skipped;
+				}
+			}
+			return skipped;
+		}
 
-		// Instantiiere den aufzubauenden Baum
-		WishTree tree(start);
+		// Genug Sätze pro Block, damit die Threads selten aufeinander warten
+		const unsigned block = 256*pool.size();
+		std::vector<std::string> sentences;
+		std::vector<SentenceResult> results;
+		while(in)
+		{
+			sentences.clear();
+			while(sentences.size() < block && std::getline(in,line))
+			{
+				sentences.push_back(line);
+			}
+			if(sentences.empty())
+			{
+				break;
+			}
 
-		// Parse rekursiv mit diesen Starteinstellungen
-		parse_recursive(input_pos,input.end(),to_be_expanded,SymbolSet(),tree);
+			// Verteile zusammenhängende Abschnitte auf die Threads
+			results.assign(sentences.size(),SentenceResult());
+			for(unsigned i = 0; i < sentences.size(); ++i)
+			{
+				pool.push(i*pool.size()/sentences.size(),i);
+			}
+			CorpusJob job(*this,contexts,sentences,results,first);
+			pool.run(job);
 
-		// Speichere die gefundenen Bäume
-		save_trees(outfile);
+			// Gib die Ergebnisse in der Reihenfolge der Eingabe aus
+			for(unsigned i = 0; i < results.size(); ++i)
+			{
+				out << results[i].output;
+				std::cerr << results[i].log;
+				if(results[i].skipped)
+				{
+					++skipped;
+				}
+			}
+			first += sentences.size();
+		}
+		return skipped;
 	}
 
 	private:
@@ -123,24 +738,225 @@ class TDBParser
 	////////////////////////////////////////////////////////////////////////////
 	// Daten
 
-	Grammar		grammar;	///< Map mit den Produktionsregeln der Grammatik
-	Lexicon		lexicon;	///< Map mit den Lexikonregeln
-	TreeSet		trees;		///< Menge der gefundenen Parsebäume
-	unsigned	si_count;	///< Anzahl der Symbolinstanzen
+	CompiledGrammar	grammar;	///< Übersetzte Grammatik mit Lexikon
+	Engine		engine;		///< Verfahren, mit dem geparst wird
+	bool		streaming;	///< Bäume sofort schreiben ja/nein
+	bool		memo;		///< Tabelle abgeschlossener Expansionen ja/nein
+	Mode		mode;		///< Gewünschtes Ergebnis pro Satz
+	unsigned	limit;		///< Anzahl der Bäume im Modus FIRST
+	Tokenizer	tokenizer;	///< Regeln zum Zerlegen der Sätze
 
 	////////////////////////////////////////////////////////////////////////////
 	// Private Funktionen
 
+	/// Konstruktor eines Parsers ohne Grammatik für load()
+	TDBParser()
+	{
+		engine = BACKTRACKING;
+		streaming = false;
+		memo = false;
+		mode = ALL;
+		limit = 0;
+	}
+
+	/// Blendet die Grammatik aus dem Cache ein oder übersetzt sie
+	/** Ist ein Cache angegeben, wird er nach dem Übersetzen neu geschrieben.
+	    @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @param cachefile Dateiname des Caches oder leer
+	    @param error Fehlermeldung beim Einlesen
+	    @return Grammatik geladen ja/nein
+	  */
+	bool load_grammar(const std::string& grammarfile,
+	                  const std::string& lexiconfile,
+	                  const std::string& cachefile, std::string& error)
+	{
+		if(!cachefile.empty() &&
+		   GrammarCache::load(cachefile,grammarfile,lexiconfile,grammar))
+		{
+			return true;
+		}
+		// Der Kopf hält den Stand der Quelldateien vor dem Einlesen fest
+		GrammarCache::Header head;
+		const bool stamped = GrammarCache::header(grammarfile,lexiconfile,head);
+		if(!compile_sources(grammarfile,lexiconfile,grammar,error))
+		{
+			return false;
+		}
+		if(!cachefile.empty() &&
+		   !(stamped && GrammarCache::save(cachefile,head,grammar)))
+		{
+			std::cerr << "Warnung: Cache '" << cachefile
+			          << "' kann nicht geschrieben werden.\n";
+		}
+		return true;
+	}
+
+	/// Liest Grammatik und Lexikon ein und übersetzt sie
+	/** Grammatik und Lexikon werden gleichzeitig eingelesen, ein großes
+	  * Lexikon zusätzlich in Abschnitten auf allen Kernen. Die Teilergebnisse
+	  * werden danach zusammengeführt. Fehler werden wie beim Einlesen am
+	  * Stück gemeldet: der erste Fehler der Grammatik, sonst der erste des
+	  * Lexikons, jeweils mit Zeile und Spalte in der Datei.
+	    @param grammarfile Dateiname der Grammatik
+	    @param lexiconfile Dateiname des Lexikons
+	    @param compiled Übersetzte Grammatik
+	    @param error Fehlermeldung beim Einlesen
+	    @return Fehlerfrei eingelesen ja/nein
+	  */
+	static bool compile_sources(const std::string& grammarfile,
+	                            const std::string& lexiconfile,
+	                            CompiledGrammar& compiled, std::string& error)
+	{
+		std::string grammar_text;
+		std::string lexicon_text;
+		if(!DCGReader::read_file(grammarfile,grammar_text,error) ||
+		   !DCGReader::read_file(lexiconfile,lexicon_text,error))
+		{
+			return false;
+		}
+
+		unsigned threads = boost::thread::hardware_concurrency();
+		if(threads == 0)
+		{
+			threads = 1;
+		}
+
+		// Teil 0 ist die Grammatik, danach folgen die Abschnitte des Lexikons
+		SourcePartList parts(1);
+		parts[0].filename = &grammarfile;
+		parts[0].lexicon = false;
+		parts[0].begin = grammar_text.c_str();
+		parts[0].end = parts[0].begin+grammar_text.size();
+		parts[0].line = 1;
+		parts[0].column = 1;
+		split_lexicon(lexiconfile,lexicon_text,threads,parts);
+
+		SourcePool pool(std::min<unsigned>(threads,parts.size()));
+		for(unsigned i = 0; i < parts.size(); ++i)
+		{
+			pool.push(i,i);
+		}
+		LoadJob job(parts);
+		pool.run(job);
+
+		// Melde den ersten Fehler in Dateireihenfolge
+		for(SourcePartList::const_iterator p = parts.begin();
+		    p != parts.end(); ++p)
+		{
+			if(!p->error.empty())
+			{
+				error = p->error;
+				return false;
+			}
+		}
+
+		// Führe die Abschnitte des Lexikons zusammen
+		for(unsigned i = 2; i < parts.size(); ++i)
+		{
+			parts[1].entries.merge(parts[i].entries);
+			parts[i].entries = LexiconEntries();
+		}
+		compiled.compile(parts[0].rules,parts[1].entries);
+		return true;
+	}
+
+	/// Teilt ein Lexikon an Regelgrenzen in Abschnitte
+	/** Ein Abschnitt endet hinter einem Punkt und dem folgenden Whitespace.
+	  * Der Punkt darf nicht in einem Kommentar stehen, also nicht hinter
+	  * einem Prozentzeichen in derselben Zeile. Da Tokens auch in
+	  * Anführungszeichen keinen Whitespace enthalten, ist jeder andere
+	  * solche Punkt das Ende einer Regel. Kleine Lexika bleiben am Stück.
+	    @param filename Dateiname des Lexikons
+	    @param text Inhalt des Lexikons
+	    @param threads Anzahl der Threads
+	    @param parts Liste, an die die Abschnitte angehängt werden
+	  */
+	static void split_lexicon(const std::string& filename,
+	                          const std::string& text, const unsigned threads,
+	                          SourcePartList& parts)
+	{
+		const char* begin = text.c_str();
+		const char* end = begin+text.size();
+		const std::size_t chunk = std::max<std::size_t>(MIN_CHUNK,
+		                                                text.size()/threads+1);
+		const char* pos = begin;
+		unsigned line = 1;
+		unsigned column = 1;
+		while(true)
+		{
+			// Suche die erste Regelgrenze hinter der Zielgröße
+			const char* split = end;
+			if(std::size_t(end-pos) > chunk)
+			{
+				for(const char* c = pos+chunk; c+1 < end; ++c)
+				{
+					if(*c == '.' && isspace(static_cast<unsigned char>(c[1])) &&
+					   !in_comment(pos,c))
+					{
+						split = c+2;
+						break;
+					}
+				}
+			}
+
+			SourcePart part;
+			part.filename = &filename;
+			part.lexicon = true;
+			part.begin = pos;
+			part.end = split;
+			part.line = line;
+			part.column = column;
+			parts.push_back(part);
+			if(split == end)
+			{
+				break;
+			}
+
+			// Zeile und Spalte des nächsten Abschnitts
+			for(const char* c = pos; c != split; ++c)
+			{
+				if(*c == '\n')
+				{
+					++line;
+					column = 1;
+				}
+				else
+				{
+					++column;
+				}
+			}
+			pos = split;
+		}
+	}
+
+	/// Prüft, ob eine Stelle hinter einem Prozentzeichen ihrer Zeile steht
+	/** @param begin Frühestes Zeichen, das betrachtet wird
+	    @param c Zu prüfende Stelle
+	    @return In einem Kommentar ja/nein
+	  */
+	static bool in_comment(const char* begin, const char* c)
+	{
+		while(c != begin && *(c-1) != '\n')
+		{
+			--c;
+			if(*c == '%')
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	/// Baut die interne Grammatik aus dem Prolog-Format auf
 	/** Nutzt die Klasse DCGReader als Automat zum Einlesen der
-	  * Prolog-DCG-Regeln und fügt sie der internen Grammatik
-	  * hinzu.
-	    @param prologfile Dateiname der Grammatik
+	  * Prolog-DCG-Regeln und fügt sie der Grammatik hinzu.
+	    @param grammar_reader Automat für die Grammatik
+	    @param grammar Grammatik, in die die Regeln eingetragen werden
 	  */
-	void init_grammar_prolog(const std::string prologfile)
+	static void init_grammar_prolog(DCGReader& grammar_reader,
+	                                Grammar& grammar)
 	{
-		// Initialisiere Automat
-		DCGReader grammar_reader(prologfile);
 		while(!grammar_reader.finished())
 		{
 			// Lies eine Regel aus der Datei
@@ -169,235 +985,779 @@ class TDBParser
 
 	/// Baut das interne Lexikon aus dem Prolog-Format auf
 	/** Nutzt die Klasse DCGReader als Automat zum Einlesen der
-	  * Prolog-DCG-Regeln und fügt sie dem internen Lexikon
-	  * hinzu.
-	    @param prologfile Dateiname des Lexikons
+	  * Prolog-DCG-Regeln und fügt sie dem Lexikon hinzu.
+	    @param lexicon_reader Automat für das Lexikon oder einen Abschnitt
+	    @param lexicon Lexikon, in das die Regeln eingetragen werden
 	  */
-	void init_lexicon_prolog(const std::string prologfile)
+	static void init_lexicon_prolog(DCGReader& lexicon_reader,
+	                                LexiconEntries& lexicon)
 	{
-		// Initialisiere Automat
-		DCGReader lexicon_reader(prologfile,true);
 		while(!lexicon_reader.finished())
 		{
-			// Lies eine Regel aus der Datei
+			// Lies eine Regel aus der Datei und füge sie dem Lexikon hinzu,
+			// doppelte Regeln entfernt erst das Übersetzen
 			std::pair<Token,Symbol> rule = lexicon_reader.run_lexicon();
+			lexicon.add(rule.first,rule.second);
+		}
+	}
+
+	/// Misst die Zeit seit einem Zeitpunkt und setzt ihn neu
+	/** @param start Zeitpunkt, danach die aktuelle Zeit
+	    @param micro Ziel für die Mikrosekunden oder 0
+	  */
+	static void lap(boost::posix_time::ptime& start, long* micro)
+	{
+		if(micro != 0)
+		{
+			const boost::posix_time::ptime now =
+				boost::posix_time::microsec_clock::universal_time();
+			*micro = (now-start).total_microseconds();
+			start = now;
+		}
+	}
 
-			// Füge sie dem internen Lexikon hinzu
-			Lexicon::iterator i = lexicon.find(rule.first);
-			if(i == lexicon.end())
+	/// Bereitet einen Kontext für Durchläufe des Parsers vor
+	/** Legt die Chart-Parser des gewählten Verfahrens an, deren Tabellen
+	  * sich beim Parsen ändern.
+	    @param context Kontext
+	  */
+	void init_context(ParseContext& context) const
+	{
+		if(engine == EARLEY || (engine == BACKTRACKING && mode == FOREST))
+		{
+			// Das Backtracking baut keinen Wald, dafür springt Earley ein
+			context.earley.reset(new EarleyParser(grammar));
+		}
+		else if(engine == CYK)
+		{
+			context.cyk.reset(new CYKParser(grammar));
+		}
+	}
+
+	/// Parst einen Satz des Korpus
+	/** Schreibt Kopfzeile und Bäume des Satzes in eine Ausgabe, Warnungen
+	  * und Meldungen über unbekannte Wörter in das Log des Ergebnisses.
+	  * Leere und übersprungene Sätze erhalten ein Ergebnis ohne Bäume,
+	  * in den Modi COUNT und EXISTS also eine 0, damit jeder Satz gleich
+	  * viele Ergebniszeilen hat.
+	    @param number Nummer des Satzes
+	    @param sentence Satz
+	    @param context Kontext des Threads
+	    @param out Ausgabe für Kopfzeile und Bäume
+	    @param result Ergebnis des Satzes
+	  */
+	void parse_sentence(const unsigned number, const std::string& sentence,
+	                    ParseContext& context, std::ostream& out,
+	                    SentenceResult& result) const
+	{
+		out << "% " << number << ": " << sentence << "\n";
+
+		TokenIdList ids;
+		std::string error;
+		if(!tokenizer.run(sentence,grammar.token_table(),ids,error))
+		{
+			// Satz überspringen und melden, das Korpus läuft weiter
+			std::ostringstream log;
+			log << "Satz " << number << " übersprungen: " << error << "\n";
+			result.log = log.str();
+			result.skipped = true;
+			context.reset();
+			write_result(out,context);
+		}
+		else if(ids.empty())
+		{
+			// Leere Zeile, keine Bäume, aber ein Ergebnis wie jeder Satz
+			context.reset();
+			write_result(out,context);
+		}
+		else
+		{
+			// Leere den Kontext und suche die Bäume
+			context.reset();
+			context.stream = streaming ? &out : 0;
+			parse_tokens(ids,context);
+			context.stream = 0;
+			write_result(out,context);
+			result.log = context.log.str();
+		}
+	}
+
+	/// Sucht alle Bäume zu einem Satz
+	/** Parst den Satz mit dem gewählten Verfahren und trägt die Bäume in die
+	  * Menge gefundener Bäume ein.
+	    @param ids Indizes der Input-Tokens, alle im Lexikon enthalten
+	    @param context Kontext des Durchlaufs
+	  */
+	void parse_tokens(const TokenIdList& ids, ParseContext& context) const
+	{
+		if(engine == EARLEY || engine == CYK || mode == FOREST)
+		{
+			// Erkenne den Satz im Chart und zähle die Bäume des Waldes auf
+			ParseForest& forest = context.forest;
+			forest.clear();
+			if(engine == CYK)
 			{
-				// Noch keine Regel für das Wort vorhanden, füge einen neuen
-				// Eintrag mit der gefundenen Regel zum Lexikon hinzu
-				SymbolSet new_ss;
-				new_ss.insert(rule.second);
-				lexicon[rule.first] = new_ss;
+				context.cyk->parse(ids,forest);
 			}
 			else
 			{
-				// Bereits Regeln für das Wort vorhanden, füge die gefundene
-				// dort ein
-				i->second.insert(rule.second);
+				context.earley->parse(ids,forest);
+			}
+			if(mode == FOREST)
+			{
+				// Der Wald wird unverändert geschrieben
+				return;
 			}
+			if(mode == COUNT || mode == EXISTS)
+			{
+				// Nur zählen, die Bäume werden nie als String aufgebaut
+				context.forest_count =
+					forest.count(grammar.symbol_table(),context.log,
+					             mode == EXISTS ? 1 : ~boost::uint64_t(0));
+				return;
+			}
+			TreeSet found;
+			forest.trees(found,grammar.symbol_table(),grammar.token_table(),
+			             context.log);
+			// Der Wald liefert die Bäume erst nach der Aufzählung
+			for(TreeSet::const_iterator i = found.begin();
+			    i != found.end() && !*context.stop; ++i)
+			{
+				emit_tree(*i,context);
+			}
+		}
+		else
+		{
+			// Iteriere über Input
+			TokenIdList::const_iterator input_pos = ids.begin();
+
+			// Lege die Kategorien jedes Tokens als Bitmenge ab
+			init_lookahead(ids,context);
+			if(memo)
+			{
+				// Leere Tabelle
+				context.memo_index.clear();
+				context.memo.clear();
+				context.segments.clear();
+				context.memo_full = false;
+			}
+
+			// Instantiiere Stapel zu expandierender Symbole mit Startsymbol
+			SymbolStack to_be_expanded = SymbolStack().push(grammar.start());
+
+			// Instantiiere den aufzubauenden Baum
+			WishTree tree;
+
+			// Parse rekursiv mit diesen Starteinstellungen
+			parse_iterative(input_pos,ids.end(),to_be_expanded,
+			                grammar.min_yield(grammar.start()),SymbolChain(),
+			                tree,context);
 		}
 	}
 
-	/// Initialisiert Daten für Durchlauf des Parsers
-	/** Setzt interne Daten auf Anfangswerte für einen Durchlauf des Parsers.
+	/// Sucht die Bäume zu einem Satz parallel mit Backtracking
+	/** Die Teilsuchen laufen mit eigenen Kontexten; deren Bäume und
+	  * Warnungen werden danach in den übergebenen Kontext übernommen.
+	    @param ids Indizes der Input-Tokens, mindestens eines
+	    @param context Kontext, in dem die Ergebnisse gesammelt werden
+	    @param threads Anzahl der Threads
 	  */
-	void init_parse()
+	void parse_parallel(const TokenIdList& ids, ParseContext& context,
+	                    const unsigned threads) const
 	{
-		// Leere Menge gefundener Bäume
-		trees = TreeSet();
+		SearchPool pool(threads);
+		ContextList contexts(pool.size());
+		for(unsigned w = 0; w < pool.size(); ++w)
+		{
+			contexts[w].reset(new ParseContext());
+			contexts[w]->pool = &pool;
+			contexts[w]->stream = context.stream;
+			contexts[w]->seen = context.seen;
+			contexts[w]->stream_lock = context.stream_lock;
+			contexts[w]->stop = context.stop;
+			init_lookahead(ids,*contexts[w]);
+		}
 
-		// IDs für die Symbolinstanzen beginnen bei 0
-		si_count = 0;
+		// Die Wurzel der Suche ist die erste Aufgabe
+		SearchTask root;
+		root.input_pos = ids.begin();
+		root.to_be_expanded = SymbolStack().push(grammar.start());
+		root.pending = grammar.min_yield(grammar.start());
+		root.depth = 0;
+		pool.push(0,root);
+		SearchJob job(*this,contexts,ids.end());
+		pool.run(job);
+
+		// Vereinige die Ergebnisse der Threads; die Bäume des Modus FIRST
+		// sind über die geteilten Abdrücke schon entdoppelt und begrenzt
+		for(unsigned w = 0; w < pool.size(); ++w)
+		{
+			context.found.insert(contexts[w]->found.begin(),
+			                     contexts[w]->found.end());
+			context.trees.insert(contexts[w]->trees.begin(),
+			                     contexts[w]->trees.end());
+			context.log << contexts[w]->log.str();
+		}
 	}
 
-	/// Prüft, ob alle Tokens im Lexikon stehen
-	/** Überprüft für jedes Token des Inputs, ob dafür Lexikonregeln
-	  * existieren. Bricht im negativen Falle das Parsing ab.
-	    @param tokens Liste der Input-Tokens
+	/// Übergibt einen vom Backtracking gefundenen Baum
+	/** Doppelte Bäume werden über ihre Struktur erkannt, bevor sie als
+	  * String ausgegeben werden. Ohne Streaming und Abbruch wird der Baum
+	  * nur in die Menge des Kontexts eingefügt und erst am Ende ausgegeben.
+	  * Sonst wird er über seinen Fingerabdruck mit den bisherigen Bäumen
+	  * verglichen und, falls neu, in den Modi COUNT und EXISTS nur gezählt,
+	  * sonst im Puffer des Kontexts als String aufgebaut und weitergegeben.
+	    @param tree Baum
+	    @param context Kontext des Durchlaufs
 	  */
-	void check_tokens(const TokenList tokens) const
+	void found_tree(const WishTree& tree, ParseContext& context) const
 	{
-		// Iteriere über die Tokens
-		for(TokenList::const_iterator t = tokens.begin(); t != tokens.end(); ++t)
+		if(mode == ALL && context.stream == 0)
 		{
-			// Schlage Token im Lexikon nach
-			Lexicon::const_iterator l = lexicon.find(*t);
-			if(l == lexicon.end())
-			{
-				// Token nicht im Lexikon, Abbruch
-				std::cerr << "Unbekanntes Wort: "
-				          << "Keine Lexikonregel für Terminal '"
-				          << *t << "' gefunden.\n";
-				exit(1);
-			}
+			context.found.insert(tree);
+			return;
+		}
+		boost::mutex::scoped_lock guard(*context.stream_lock);
+		if(*context.stop || !context.seen->insert(tree.fingerprint()))
+		{
+			return;
+		}
+		if(mode == EXISTS)
+		{
+			*context.stop = true;
+		}
+		else if(mode != COUNT)
+		{
+			deliver_tree(context.writer.write(tree,grammar.symbol_table(),
+			                                  grammar.token_table()),context);
 		}
 	}
 
-	/// Rekursiver Teil des Parsings
-	/** Probiert für ein Symbol alle Möglichkeiten der Expansion rekursiv aus.
+	/// Übergibt einen gefundenen Baum als String
+	/** Ohne Streaming und Abbruch wird der Baum nur in die Menge des
+	  * Kontexts eingefügt. Sonst wird er über seinen Fingerabdruck mit den
+	  * bisherigen Bäumen verglichen und, falls neu, sofort geschrieben bzw.
+	  * eingefügt; im Modus FIRST endet die Suche beim n-ten neuen Baum.
+	    @param tree Baum als String
+	    @param context Kontext des Durchlaufs
+	  */
+	void emit_tree(const std::string& tree, ParseContext& context) const
+	{
+		if(mode == ALL && context.stream == 0)
+		{
+			context.trees.insert(tree);
+			return;
+		}
+		boost::mutex::scoped_lock guard(*context.stream_lock);
+		if(*context.stop || !context.seen->insert(tree))
+		{
+			return;
+		}
+		if(mode == EXISTS)
+		{
+			*context.stop = true;
+		}
+		else if(mode != COUNT)
+		{
+			deliver_tree(tree,context);
+		}
+	}
+
+	/// Schreibt einen neuen Baum sofort oder fügt ihn in die Menge ein
+	/** Muss unter dem Schutz von stream_lock aufgerufen werden. Im Modus
+	  * FIRST endet die Suche beim n-ten neuen Baum.
+	    @param tree Baum als String
+	    @param context Kontext des Durchlaufs
+	  */
+	void deliver_tree(const std::string& tree, ParseContext& context) const
+	{
+		if(context.stream != 0)
+		{
+			*context.stream << tree << "\n";
+		}
+		else
+		{
+			context.trees.insert(tree);
+		}
+		if(mode == FIRST && context.seen->size() >= limit)
+		{
+			*context.stop = true;
+		}
+	}
+
+	/// Schreibt das Ergebnis eines Satzes
+	/** Schreibt die gesammelten Bäume, sofern sie nicht schon gestreamt
+	  * wurden, bzw. die Anzahl der Bäume, 1/0 für ihre Existenz oder den
+	  * gepackten Parsewald.
+	    @param out Ausgabe
+	    @param context Kontext des Durchlaufs
+	  */
+	void write_result(std::ostream& out, const ParseContext& context) const
+	{
+		if(mode == COUNT)
+		{
+			out << tree_count(context) << "\n";
+		}
+		else if(mode == FOREST)
+		{
+			context.forest.write(out,grammar.symbol_table(),
+			                     grammar.token_table());
+		}
+		else if(mode == EXISTS)
+		{
+			out << (tree_count(context) > 0 ? 1 : 0) << "\n";
+		}
+		else if(!streaming)
+		{
+			write_trees(out,context);
+		}
+	}
+
+	/// Gibt die Anzahl der Bäume eines Satzes im Modus COUNT oder EXISTS aus
+	/** Die Chart-Verfahren zählen im Wald, das Backtracking über die
+	  * Fingerabdrücke der gefundenen Bäume.
+	  */
+	boost::uint64_t tree_count(const ParseContext& context) const
+	{
+		if(engine == BACKTRACKING)
+		{
+			return context.seen->size();
+		}
+		return context.forest_count;
+	}
+
+	/// Legt die Kategorien der Input-Tokens als Bitmengen ab
+	/** Bildet für jede Position die Menge der Präterminale des Tokens, mit
+	  * der die Regeln vor ihrer Expansion verglichen werden.
+	    @param ids Indizes der Input-Tokens
+	    @param context Kontext des Durchlaufs
+	  */
+	void init_lookahead(const TokenIdList& ids, ParseContext& context) const
+	{
+		const unsigned words = grammar.set_words();
+		context.input_begin = ids.begin();
+		context.lookahead.assign(ids.size()*words,0);
+		for(unsigned i = 0; i < ids.size(); ++i)
+		{
+			grammar.categories_into(ids[i],&context.lookahead[i*words]);
+		}
+	}
+
+	/// Liefert die Kategorien des Tokens an einer Input-Position
+	const BitWord* lookahead_at(const TokenIdList::const_iterator pos,
+	                            const ParseContext& context) const
+	{
+		return &context.lookahead[(pos-context.input_begin)*grammar.set_words()];
+	}
+
+	/// Suche des Backtrackings
+	/** Probiert für ein Symbol alle Möglichkeiten der Expansion aus. Statt
+	  * sich selbst aufzurufen, legt die Funktion für jedes expandierte
+	  * Nichtterminal einen Auswahlpunkt auf einen eigenen Stapel, ähnlich
+	  * dem Choice-Point-Stack der WAM. Ein Schritt in die Tiefe legt einen
+	  * kleinen Eintrag ab, Backtracking nimmt ihn wieder herunter. Der
+	  * Speicherbedarf hängt so nur von der Suchtiefe ab, und lange Sätze
+	  * können den Aufrufstapel nicht mehr überlaufen lassen. Die Bäume
+	  * werden in derselben Reihenfolge gefunden wie bei einer Rekursion.
+	  *
+	  * Mit Tabelle legt jede neu gesuchte Expansion eine Marke unter ihre
+	  * rechte Regelseite auf den Stapel. Kommt die Marke nach oben, ist die
+	  * Expansion abgeschlossen und ihr Teilbaum wird festgehalten. Ist ihr
+	  * Auswahlpunkt erschöpft, ist der Eintrag vollständig; ein späterer
+	  * Auswahlpunkt probiert dann dessen Ergebnisse statt der Regeln.
 	    @param input_pos Iterator auf die aktuelle Position im Input
 	    @param input_end Iterator auf das Ende des Inputs
 	    @param to_be_expanded Stapel zu expandierender Symbole
-	    @param left_expanding Menge der Symbole, die gerade linksexpandiert werden
+	    @param pending Summe der Mindestlängen der Symbole auf dem Stapel
+	    @param left_expanding Kette der Symbole, die gerade linksexpandiert werden
 	    @param tree Bisher aufgebauter Baum
+	    @param context Kontext des Durchlaufs
 	  */
-	void parse_recursive(TokenList::const_iterator input_pos,
-	                     TokenList::const_iterator input_end,
-	                     SymbolStack to_be_expanded, SymbolSet left_expanding,
-	                     WishTree tree)
+	void parse_iterative(TokenIdList::const_iterator input_pos,
+	                     const TokenIdList::const_iterator input_end,
+	                     SymbolStack to_be_expanded, unsigned pending,
+	                     SymbolChain left_expanding, WishTree tree,
+	                     ParseContext& context) const
 	{
-		// Nimm oberstes Symbol vom Stapel zu expandierender Symbole
-		SymbolInstance si = to_be_expanded.top();
-		to_be_expanded.pop();
+		ChoiceStack& choices = context.choices;
+		choices.clear();
+		// Tiefe des Auswahlpunkts i ist base+i
+		const unsigned base = context.depth;
+		// Die Tabelle gibt es nur in der sequentiellen Suche
+		const bool memoize = memo && context.pool == 0;
+		const unsigned length = input_end-context.input_begin;
+		bool entering = true;
 
-		// Füge Symbol in die Menge von Symbolen ein, die gerade linksexpandiert
-		// werden, und prüfe dabei, ob es schon enthalten ist
-		bool no_left_recursion = left_expanding.insert(si.symbol).second;
-		if(no_left_recursion)
+		while(true)
 		{
-			// Suche Grammatikregeln für das Symbol
-			Grammar::const_iterator rhs_list = grammar.find(si.symbol);
-			if(rhs_list == grammar.end())
+			// Betritt den aktuellen Zustand, sofern einer ansteht
+			if(entering && !*context.stop &&
+			   pending <= unsigned(input_end-input_pos))
 			{
-				// Keine Produktionsregel gefunden, suche Lexikonregel für
-				// das Symbol und das nachfolgende Wort des Inputs
-				Lexicon::const_iterator lex_set = lexicon.find(*input_pos);
-				if(lex_set->second.find(si.symbol) != lex_set->second.end())
+				if(pending == 0 && input_pos != input_end)
+				{
+					// Jedes Symbol der Grammatik braucht ein Token; auf dem
+					// Stapel liegen höchstens noch Marken der Tabelle, und
+					// der Rest des Inputs bliebe übrig
+					entering = false;
+					continue;
+				}
+				if(to_be_expanded.empty())
+				{
+					// Parsing erfolgreich! Speichere Baum
+					found_tree(tree,context);
+					entering = false;
+					continue;
+				}
+
+				// Nimm oberstes Symbol vom Stapel zu expandierender Symbole
+				const SymbolId symbol = to_be_expanded.front();
+				SymbolStack rest = to_be_expanded.rest();
+
+				if(symbol & MEMO_MARK)
+				{
+					// Expansion abgeschlossen, halte ihren Teilbaum und die
+					// der mit ihr endenden äußeren Expansionen fest und
+					// fahre ohne weiteres Token mit dem Rest fort
+					for(unsigned index = symbol & ~MEMO_MARK;
+					    index != NO_ENTRY && !context.memo_full;
+					    index = context.memo[index].outer)
+					{
+						record_expansion(index,input_pos-context.input_begin,
+						                 left_expanding,tree,context);
+					}
+					to_be_expanded = rest;
+					continue;
+				}
+				else if(std::find(left_expanding.begin(),left_expanding.end(),
+				                  symbol) != left_expanding.end())
+				{
+					// Linksrekursion entdeckt, Warnhinweis ausgeben und den
+					// aktuellen Parsingversuch nicht weiterverfolgen
+					context.log << "Warnung: Linksrekursion bei der Expansion des "
+					          << "Symbols '" << grammar.symbol_table().name(symbol)
+					          << "' entdeckt. "
+					          << "Entsprechende Regeln werden ignoriert.\n";
+				}
+				else if(grammar.is_preterminal(symbol))
+				{
+					// Suche Lexikonregel für das Symbol und das nachfolgende
+					// Wort des Inputs; der Schritt ist eindeutig und braucht
+					// keinen Auswahlpunkt
+					if(BitVector::test(lookahead_at(input_pos,context),symbol))
+					{
+						// Fahre mit dem nächsten Symbol fort; ist der Stapel
+						// am Ende des Inputs leer, ist der Baum vollständig
+						tree = WishTree(tree,symbol,*input_pos);
+						++input_pos;
+						to_be_expanded = rest;
+						--pending;
+						left_expanding = SymbolChain();
+						continue;
+					}
+				}
+				else
 				{
-					// Passende Lexikonregel gefunden
-					// Füge dem Baum den entsprechenden Ast hinzu
-					WishTree new_tree(tree,si,*input_pos);
-					// Rücke im Input weiter
-					++input_pos;
-					// Prüfe, ob Ende des Inputs erreicht ist
-					if(input_pos == input_end)
+					// Lege einen Auswahlpunkt für die Regeln des Symbols ab
+					choices.push_back(ChoicePoint());
+					ChoicePoint& choice = choices.back();
+					choice.input_pos = input_pos;
+					choice.symbol = symbol;
+					choice.rest = rest;
+					choice.rest_yield = pending-grammar.min_yield(symbol);
+					choice.chain = left_expanding.push(symbol);
+					choice.tree = tree;
+					choice.categories = lookahead_at(input_pos,context);
+					choice.rule = grammar.rules_begin(symbol);
+					choice.entry = NO_ENTRY;
+					choice.reuse = false;
+					choice.next = 0;
+					if(memoize)
 					{
-						// Prüfe, ob Stapel leer ist
-						if(to_be_expanded.empty())
-						{
-							// Parsing erfolgreich! Speichere Baum
-							trees.insert(new_tree.str());
-						}
+						enter_expansion(choice,input_pos-context.input_begin,
+						                length-choice.rest_yield,context);
 					}
-					else
+				}
+			}
+			entering = false;
+
+			// Backtracking: nächste Regel des obersten Auswahlpunkts
+			if(choices.empty())
+			{
+				break;
+			}
+			ChoicePoint& choice = choices.back();
+			if(choice.reuse)
+			{
+				// Nächstes Ergebnis der Tabelle, das vor der Grenze endet
+				const MemoEntry& entry = context.memo[choice.entry];
+				const unsigned reach = length-choice.rest_yield;
+				for(; choice.next < entry.results.size() && !*context.stop;
+				    ++choice.next)
+				{
+					const MemoResult& result = entry.results[choice.next];
+					if(result.end > reach)
 					{
-						// Prüfe, ob Stapel noch voll ist
-						if(!to_be_expanded.empty())
-						{
-							// Parse auf Grundlage der neuen Einstellungen
-							parse_recursive(input_pos,input_end,to_be_expanded,SymbolSet(),new_tree);
-						}
+						continue;
 					}
+					// Übernimm den Teilbaum und fahre hinter ihm fort
+					input_pos = context.input_begin+result.end;
+					to_be_expanded = choice.rest;
+					pending = choice.rest_yield;
+					left_expanding = result.chain;
+					tree = WishTree(choice.tree,*result.segment);
+					entering = true;
+					++choice.next;
+					break;
+				}
+				if(!entering)
+				{
+					choices.pop_back();
 				}
+				continue;
 			}
-			else
+			const unsigned depth = base+choices.size()-1;
+			const unsigned remaining = input_end-choice.input_pos;
+			const CompiledGrammar::RuleId end = grammar.rules_end(choice.symbol);
+			for(; choice.rule != end && !*context.stop; ++choice.rule)
+			{
+				const CompiledGrammar::RuleId rule = choice.rule;
+				// Überspringe Regeln, die nicht mit einer Kategorie des
+				// aktuellen Tokens beginnen können
+				if(!BitVector::intersects(grammar.first_of_rule(rule),
+				                          choice.categories,grammar.set_words()))
+				{
+					continue;
+				}
+				// Überspringe Regeln, deren Symbole zusammen mit dem Rest
+				// des Stapels mehr Tokens brauchen, als übrig sind
+				const unsigned new_pending = CompiledGrammar::add_yield(
+					choice.rest_yield,grammar.min_yield_of_rule(rule));
+				if(new_pending > remaining)
+				{
+					continue;
+				}
+				// Lege die Symbole der rechten Regelseite auf den Stapel
+				// und füge dem Baum die entsprechenden Äste hinzu
+				SymbolStack new_stack = push_list_to_stack(rule,choice.rest);
+				WishTree new_tree(choice.tree,choice.symbol,
+				                  grammar.rhs_begin(rule),grammar.rhs_length(rule));
+				if(context.pool != 0 && depth < FORK_DEPTH &&
+				   remaining >= FORK_MIN_TOKENS)
+				{
+					// Nahe der Wurzel: Alternative als Aufgabe verteilen
+					SearchTask task;
+					task.input_pos = choice.input_pos;
+					task.to_be_expanded = new_stack;
+					task.pending = new_pending;
+					task.left_expanding = choice.chain;
+					task.tree = new_tree;
+					task.depth = depth+1;
+					context.pool->push(context.worker,task);
+					continue;
+				}
+				// Gehe mit der Regel in die Tiefe
+				input_pos = choice.input_pos;
+				to_be_expanded = new_stack;
+				pending = new_pending;
+				left_expanding = choice.chain;
+				tree = new_tree;
+				entering = true;
+				++choice.rule;
+				break;
+			}
+			if(!entering)
 			{
-				// Iteriere über die gefundenen Produktionsregeln
-				for(SymbolListList::const_iterator rule = rhs_list->second.begin();
-					rule != rhs_list->second.end(); ++rule)
+				// Alle Regeln ausprobiert, Auswahlpunkt entfernen
+				if(choice.entry != NO_ENTRY && !*context.stop &&
+				   !context.memo_full)
 				{
-					// Betrachte die Regel und erzeuge aus der rechten Regelseite
-					// eine Liste identifizierbarer Nichtterminale
-					SymbolInstanceList si_list = make_si_list(*rule);
-					// Lege die Nichtterminale auf den Stapel zu expandierender Symbole
-					SymbolStack new_stack = push_list_to_stack(si_list,to_be_expanded);
-					// Füge dem Baum die entsprechenden Äste hinzu
-					WishTree new_tree(tree,si,si_list);
-					// Parse auf Grundlage der neuen Einstellungen
-					parse_recursive(input_pos,input_end,new_stack,left_expanding,new_tree);
+					context.memo[choice.entry].complete = true;
 				}
+				choices.pop_back();
 			}
 		}
-		else
+	}
+
+	/// Schlägt ein Nichtterminal vor seiner Expansion in der Tabelle nach
+	/** Gesucht wird der Eintrag mit gleicher Linkskette vor dem Symbol. Ist
+	  * er vollständig und wurde mindestens bis zur Grenze gesucht, probiert
+	  * der Auswahlpunkt dessen Ergebnisse. Sonst wird der Eintrag neu
+	  * begonnen und eine Marke unter die Regeln gelegt, die das Ende jeder
+	  * Expansion anzeigt; ist die Tabelle voll, wird ohne sie gesucht.
+	  *
+	  * Braucht der Rest unter dem Symbol kein Token, kann eine Expansion
+	  * nur am Ende des Inputs weiterführen. Die Suche bricht vorher ab, der
+	  * Eintrag hält daher nur Expansionen bis zum Ende und dient nur
+	  * Auswahlpunkten, für die dasselbe gilt. So wächst die Tabelle bei
+	  * Rechtsrekursion nicht quadratisch mit der Satzlänge.
+	  *
+	  * Liegt direkt unter dem Symbol schon eine Marke, endet die äußere
+	  * Expansion mit dieser. Die neue Marke ersetzt sie dann und verweist
+	  * auf ihren Eintrag, sodass eine Kette rechtsrekursiver Expansionen
+	  * nur eine Marke auf dem Stapel belegt. Ist die Tabelle voll, wird
+	  * diese in einem Schritt übergangen.
+	    @param choice Neuer Auswahlpunkt des Nichtterminals
+	    @param start Position des Nichtterminals
+	    @param reach Größtes Ende, nach dem der Rest noch passt
+	    @param context Kontext des Durchlaufs
+	  */
+	void enter_expansion(ChoicePoint& choice, const unsigned start,
+	                     const unsigned reach, ParseContext& context) const
+	{
+		const SymbolChain chain = choice.chain.rest();
+		const bool tail = choice.rest_yield == 0;
+		unsigned& first = context.memo_index.insert(std::make_pair(
+			std::make_pair(start,choice.symbol),unsigned(NO_ENTRY))).first->second;
+		unsigned index = first;
+		while(index != NO_ENTRY && !same_chain(context.memo[index].chain,chain))
 		{
-			// Linksrekursion entdeckt, Warnhinweis ausgeben und den aktuellen
-			// Parsingversuch nicht weiterverfolgen
-			std::cerr << "Warnung: Linksrekursion bei der Expansion des "
-			          << "Symbols '" << si.symbol << "' entdeckt. "
-			          << "Entsprechende Regeln werden ignoriert.\n";
+			index = context.memo[index].next;
 		}
-
-		// Alle Regeln für aktuelles Symbol ausprobiert, damit ist diese Instanz
-		// der rekursiven Funktion beendet; der Ball geht wieder zur
-		// nächsthöheren Instanz, die Alternativen für ihr Symbol probieren kann
+		if(index != NO_ENTRY)
+		{
+			const MemoEntry& entry = context.memo[index];
+			if(entry.complete && entry.limit >= reach && (tail || !entry.tail))
+			{
+				choice.entry = index;
+				choice.reuse = true;
+				return;
+			}
+		}
+		if(context.memo_full ||
+		   context.memo.size()+context.segments.size() >= MEMO_LIMIT)
+		{
+			// Tabelle voll, offene Einträge bleiben unvollständig
+			context.memo_full = true;
+			return;
+		}
+		if(index == NO_ENTRY)
+		{
+			index = context.memo.size();
+			context.memo.push_back(MemoEntry());
+			context.memo.back().chain = chain;
+			context.memo.back().next = first;
+			first = index;
+		}
+		MemoEntry& entry = context.memo[index];
+		entry.start = start;
+		entry.limit = reach;
+		entry.tail = tail;
+		entry.complete = false;
+		entry.tree = choice.tree;
+		entry.results.clear();
+		entry.distinct.clear();
+		entry.outer = NO_ENTRY;
+		choice.entry = index;
+		if(!choice.rest.empty() && (choice.rest.front() & MEMO_MARK))
+		{
+			entry.outer = choice.rest.front() & ~MEMO_MARK;
+			choice.rest = choice.rest.rest();
+		}
+		choice.rest = choice.rest.push(MEMO_MARK | index);
 	}
 
-	/// Liefert eine neue Symbolinstanz
-	/** Erzeugt zu einem Symbol der Grammatik eine identifzierbare Instanz
-	  * für den Stapel zu expandierender Symbole und den Baum.
-	    @param s Symbol
-	    @return Neue Instanz des Symbols
-	  */
-	SymbolInstance new_si(Symbol s)
+	/// Vergleicht zwei Linksketten elementweise
+	static bool same_chain(const SymbolChain& a, const SymbolChain& b)
 	{
-		SymbolInstance si(s,si_count);
-		++si_count;
-		return si;
+		SymbolChain::const_iterator i = a.begin(), j = b.begin();
+		for(; i != a.end() && j != b.end(); ++i, ++j)
+		{
+			if(*i != *j)
+			{
+				return false;
+			}
+		}
+		return i == a.end() && j == b.end();
 	}
 
-	/// Liefert zu einer Liste von Symbolen eine Liste von Symbolinstanzen
-	/** Erzeugt zu jedem Symbol in einer Liste eine neue Instanz und liefert
-	  * eine korrespondierende Liste.
-	    @param s_list Liste von Symbolen
-	    @return Liste von neuen Symbolinstanzen
+	/// Hält eine abgeschlossene Expansion in der Tabelle fest
+	/** @param index Eintrag der Tabelle
+	    @param end Position hinter dem Teilbaum
+	    @param chain Linkskette am Ende der Expansion
+	    @param tree Baum mit dem Teilbaum
+	    @param context Kontext des Durchlaufs
 	  */
-	SymbolInstanceList make_si_list(SymbolList s_list)
+	void record_expansion(const unsigned index, const unsigned end,
+	                      const SymbolChain& chain, const WishTree& tree,
+	                      ParseContext& context) const
 	{
-		// Instantiiere die Liste der Symbolinstanzen
-		SymbolInstanceList si_list;
-		// Iteriere über die Liste der Symbole
-		for(SymbolList::const_iterator i = s_list.begin();
-		    i != s_list.end(); ++i)
+		if(context.memo.size()+context.segments.size() >= MEMO_LIMIT)
+		{
+			// Tabelle voll, offene Einträge bleiben unvollständig
+			context.memo_full = true;
+			return;
+		}
+		MemoEntry& entry = context.memo[index];
+		const WishTree::Segment segment(tree,entry.tree);
+		MemoResult result;
+		result.end = end;
+		result.segment = &segment;
+		if(entry.distinct.find(result) != entry.distinct.end())
 		{
-			// Füge eine neue Instanz des Symbols zur Liste der
-			// Symbolinstanzen hinzu
-			si_list.push_back(new_si(*i));
+			// Gleicher Teilbaum schon vorhanden
+			return;
 		}
-		// Gib die fertige Liste aus
-		return si_list;
+		context.segments.push_back(segment);
+		result.segment = &context.segments.back();
+		result.chain = chain;
+		entry.results.push_back(result);
+		entry.distinct.insert(result);
 	}
 
-	/// Legt Symbolinstanzen aus einer Liste auf einen Stapel
-	/** Legt die Elemente einer Liste von Symbolinstanzen in umgekehrter
-	  * Reihenfolge auf einen Stapel, sodass das erste Element zuoberst liegt.
-	    @param si_list Liste von Symbolinstanzen
+	/// Legt die Symbole einer rechten Regelseite auf einen Stapel
+	/** Legt die Symbole in umgekehrter Reihenfolge auf einen Stapel, sodass
+	  * das erste Symbol zuoberst liegt. Der neue Stapel teilt sich den alten
+	  * als Rest, der Aufwand hängt nur von der Regellänge ab.
+	    @param rule Index der Regel
 	    @param stack Stapel vorher
 	    @return Stapel nachher
 	  */
-	SymbolStack push_list_to_stack(SymbolInstanceList si_list,SymbolStack stack)
+	SymbolStack push_list_to_stack(const CompiledGrammar::RuleId rule,
+	                               const SymbolStack& stack) const
 	{
-		// Iteriere in umgekehrter Reihenfolge über die Liste
-		for(SymbolInstanceList::const_reverse_iterator i = si_list.rbegin();
-		    i != si_list.rend(); ++i)
+		SymbolStack new_stack = stack;
+		// Iteriere in umgekehrter Reihenfolge über die rechte Regelseite
+		const SymbolId* begin = grammar.rhs_begin(rule);
+		for(const SymbolId* i = grammar.rhs_end(rule); i != begin; )
 		{
-			// Lege die Symbolinstanz auf den Stapel
-			stack.push(*i);
+			// Lege das Symbol auf den Stapel
+			new_stack = new_stack.push(*--i);
 		}
 		// Gib den fertigen Stapel aus
-		return stack;
+		return new_stack;
 	}
 
-	/// Gibt die Menge gefundener Bäume aus
-	/** Speichert alle gefundenen Bäume im Wishtree/Showtree-Format, getrennt
-	  * mit Zeilenumbrüchen, in eine Textdatei.
-	    @param outfile Dateiname für die Baum-Datei
+	/// Schreibt die gefundenen Bäume sortiert in einen Stream
+	/** Die Bäume des Backtrackings werden erst hier als Strings aufgebaut
+	  * und einmal sortiert; die der Chart-Verfahren liegen schon sortiert
+	  * vor.
+	    @param out Ausgabe, ein Baum pro Zeile
+	    @param context Kontext des Durchlaufs
 	  */
-	void save_trees(const std::string outfile) const
+	void write_trees(std::ostream& out, const ParseContext& context) const
 	{
-		// Erzeuge einen Output-Filestream in die Datei
-		std::ofstream outstream;
-		outstream.open(outfile.c_str());
-		if(outstream.is_open())
+		std::vector<std::string> sorted;
+		sorted.reserve(context.found.size());
+		WishTree::Writer writer;
+		for(WishTreeSet::const_iterator i = context.found.begin();
+		    i != context.found.end(); ++i)
 		{
-			// Iteriere über die gefundenen Bäume
-			for(TreeSet::const_iterator i = trees.begin(); i != trees.end(); ++i)
-			{
-				// Gib den Baum aus
-				outstream << *i << "\n";
-			}
+			sorted.push_back(writer.write(*i,grammar.symbol_table(),
+			                              grammar.token_table()));
+		}
+		std::sort(sorted.begin(),sorted.end());
+		for(std::vector<std::string>::const_iterator i = sorted.begin();
+		    i != sorted.end(); ++i)
+		{
+			out << *i << "\n";
+		}
+		// Iteriere über die Bäume der Chart-Verfahren
+		for(TreeSet::const_iterator i = context.trees.begin();
+		    i != context.trees.end(); ++i)
+		{
+			// Gib den Baum aus
+			out << *i << "\n";
 		}
 	}
 };
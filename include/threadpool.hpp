@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// threadpool.hpp
+// Klassentemplate WorkStealingPool verteilt Aufgaben auf mehrere Threads
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_THREADPOOL_HPP__
+#define __WEGEL_TDBP_THREADPOOL_HPP__
+
+#include <deque>
+#include <boost/thread.hpp>
+#include <boost/scoped_array.hpp>
+
+/// Threadpool mit Work-Stealing
+/** Jeder Arbeiter hat eine eigene Warteschlange. Er nimmt Aufgaben vom
+  * hinteren Ende seiner Schlange und stiehlt, wenn sie leer ist, vom
+  * vorderen Ende der Schlangen anderer Arbeiter. So bleiben keine Kerne
+  * untätig, auch wenn die Aufgaben sehr unterschiedlich teuer sind.
+  * Aufgaben dürfen während eines Durchlaufs weitere Aufgaben einstellen;
+  * der Durchlauf endet, wenn keine Aufgabe mehr aussteht.
+  */
+template<typename Task>
+class WorkStealingPool
+{
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Warteschlange eines Arbeiters
+	struct Queue
+	{
+		boost::mutex		lock;	///< Schützt die Aufgaben
+		std::deque<Task>	tasks;	///< Eingestellte Aufgaben
+	};
+
+	/// Startfunktion eines Threads
+	template<typename Job>
+	struct Worker
+	{
+		WorkStealingPool*	pool;	///< Pool des Arbeiters
+		Job*				job;	///< Geteiltes Funktionsobjekt
+		unsigned			index;	///< Index des Arbeiters
+
+		/// Konstruktor aus Pool, Funktionsobjekt und Index
+		Worker(WorkStealingPool* p, Job* j, const unsigned i)
+		{
+			pool = p;
+			job = j;
+			index = i;
+		}
+
+		/// Führt die Schleife des Arbeiters aus
+		void operator()()
+		{
+			pool->work(*job,index);
+		}
+	};
+
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor für eine Anzahl von Arbeitern
+	/** @param workers Anzahl der Threads, mindestens 1
+	  */
+	WorkStealingPool(const unsigned workers)
+		: count(workers > 0 ? workers : 1), queues(new Queue[count])
+	{
+		pending = 0;
+	}
+
+	/// Gibt die Anzahl der Arbeiter aus
+	unsigned size() const
+	{
+		return count;
+	}
+
+	/// Stellt eine Aufgabe in die Schlange eines Arbeiters ein
+	/** @param worker Index des Arbeiters
+	    @param task Aufgabe
+	  */
+	void push(const unsigned worker, const Task& task)
+	{
+		{
+			boost::mutex::scoped_lock guard(pending_lock);
+			++pending;
+		}
+		Queue& q = queues[worker%count];
+		boost::mutex::scoped_lock guard(q.lock);
+		q.tasks.push_back(task);
+	}
+
+	/// Arbeitet alle eingestellten Aufgaben ab
+	/** Startet die Arbeiter und kehrt zurück, wenn alle Aufgaben erledigt
+	  * sind, auch solche, die erst während des Durchlaufs eingestellt
+	  * wurden. Jede Aufgabe wird als job(Arbeiter, Aufgabe) ausgeführt.
+	    @param job Funktionsobjekt, das von allen Arbeitern geteilt wird
+	  */
+	template<typename Job>
+	void run(Job& job)
+	{
+		boost::thread_group threads;
+		for(unsigned w = 1; w < count; ++w)
+		{
+			threads.create_thread(Worker<Job>(this,&job,w));
+		}
+		// Der aufrufende Thread ist Arbeiter 0
+		work(job,0);
+		threads.join_all();
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	const unsigned count;				///< Anzahl der Arbeiter
+	boost::scoped_array<Queue> queues;	///< Schlange pro Arbeiter
+	boost::mutex pending_lock;			///< Schützt pending
+	unsigned pending;					///< Eingestellte, nicht erledigte Aufgaben
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Schleife eines Arbeiters
+	/** @param job Auszuführendes Funktionsobjekt
+	    @param worker Index des Arbeiters
+	  */
+	template<typename Job>
+	void work(Job& job, const unsigned worker)
+	{
+		Task task;
+		while(true)
+		{
+			if(take(worker,task))
+			{
+				job(worker,task);
+				boost::mutex::scoped_lock guard(pending_lock);
+				--pending;
+			}
+			else
+			{
+				// Nichts zu tun: fertig, oder warten, bis eine laufende
+				// Aufgabe neue Aufgaben einstellt
+				{
+					boost::mutex::scoped_lock guard(pending_lock);
+					if(pending == 0)
+					{
+						return;
+					}
+				}
+				boost::this_thread::yield();
+			}
+		}
+	}
+
+	/// Holt eine Aufgabe aus der eigenen Schlange oder stiehlt eine
+	/** @param worker Index des Arbeiters
+	    @param task Geholte Aufgabe
+	    @return Aufgabe gefunden ja/nein
+	  */
+	bool take(const unsigned worker, Task& task)
+	{
+		{
+			// Jüngste eigene Aufgabe zuerst
+			Queue& own = queues[worker];
+			boost::mutex::scoped_lock guard(own.lock);
+			if(!own.tasks.empty())
+			{
+				task = own.tasks.back();
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		for(unsigned i = 1; i < count; ++i)
+		{
+			// Älteste fremde Aufgabe stehlen
+			Queue& victim = queues[(worker+i)%count];
+			boost::mutex::scoped_lock guard(victim.lock);
+			if(!victim.tasks.empty())
+			{
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+#endif
@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// tokenizer.hpp
+// Klasse Tokenizer zerlegt Sätze direkt in Indizes von Terminalen
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEGEL_TDBP_TOKENIZER_HPP__
+#define __WEGEL_TDBP_TOKENIZER_HPP__
+
+#include <string>
+#include <cctype>
+#include "globaltypes.hpp"
+#include "symboltable.hpp"
+
+/// Tokenisierer mit einstellbaren Regeln
+/** Läuft einmal über den Satz und schlägt jedes Token direkt an seiner
+  * Stelle im Satz in der Tabelle der Terminale nach, ohne es zu kopieren.
+  * Das Ergebnis ist das zusammenhängende Feld der Indizes, auf dem alle
+  * Parsing-Verfahren arbeiten.
+  *
+  * Whitespace trennt immer Tokens. Wie Satzzeichen behandelt werden, legt
+  * der Aufrufer fest (Option -p), das Lexikon wird dafür nicht befragt:
+  * Standard ist wie bei boost::tokenizer, dass sie Tokens trennen und
+  * wegfallen (DROP). Mit SPLIT ist jedes Satzzeichen ein eigenes Token, das
+  * dann im Lexikon stehen muss; mit ATTACH bleiben sie Teil des Wortes.
+  * Mit Ausgleich der Groß- und Kleinschreibung wird ein Token, das so
+  * nicht im Lexikon steht, noch einmal klein geschrieben gesucht. Steht
+  * ein Wort in beiden Schreibweisen im Lexikon, entscheidet also das
+  * Lexikon.
+  */
+class Tokenizer
+{
+	public:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Typen
+
+	/// Behandlung von Satzzeichen
+	enum Punctuation
+	{
+		DROP,	///< Satzzeichen trennen Tokens und fallen weg
+		SPLIT,	///< Jedes Satzzeichen ist ein eigenes Token
+		ATTACH	///< Satzzeichen gehören zum Wort
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// Öffentliche Funktionen
+
+	/// Konstruktor
+	/** @param p Behandlung von Satzzeichen
+	    @param f Groß- und Kleinschreibung ausgleichen ja/nein
+	  */
+	Tokenizer(const Punctuation p = DROP, const bool f = false)
+	{
+		punctuation = p;
+		fold_case = f;
+	}
+
+	/// Zerlegt einen Satz und schlägt die Indizes der Tokens nach
+	/** @param sentence Satz
+	    @param tokens Tabelle der Terminale des Lexikons
+	    @param ids Indizes der Tokens, werden angehängt
+	    @param error Fehlermeldung, falls ein Token nicht im Lexikon steht
+	    @return Alle Tokens bekannt ja/nein
+	  */
+	bool run(const std::string& sentence, const SymbolTable& tokens,
+	         TokenIdList& ids, std::string& error) const
+	{
+		const char* pos = sentence.data();
+		const char* end = pos+sentence.size();
+		while(pos != end)
+		{
+			// Überspringe Trennzeichen
+			const unsigned char c = *pos;
+			if(std::isspace(c) || (punctuation == DROP && std::ispunct(c)))
+			{
+				++pos;
+				continue;
+			}
+
+			// Suche das Ende des Tokens
+			const char* token_end = pos+1;
+			if(punctuation != SPLIT || !std::ispunct(c))
+			{
+				while(token_end != end && !separates(*token_end))
+				{
+					++token_end;
+				}
+			}
+
+			TokenId id;
+			if(!lookup(pos,token_end-pos,tokens,id))
+			{
+				// Token nicht im Lexikon
+				error = "Unbekanntes Wort: Keine Lexikonregel für Terminal '"
+				        + std::string(pos,token_end) + "' gefunden.";
+				return false;
+			}
+			ids.push_back(id);
+			pos = token_end;
+		}
+		return true;
+	}
+
+	private:
+
+	////////////////////////////////////////////////////////////////////////////
+	// Daten
+
+	Punctuation punctuation;	///< Behandlung von Satzzeichen
+	bool fold_case;				///< Groß- und Kleinschreibung ausgleichen
+
+	////////////////////////////////////////////////////////////////////////////
+	// Private Funktionen
+
+	/// Prüft, ob ein Zeichen ein Token beendet
+	bool separates(const unsigned char c) const
+	{
+		return std::isspace(c) || (punctuation != ATTACH && std::ispunct(c));
+	}
+
+	/// Schlägt ein Token nach, mit Ausgleich der Schreibung als Rückfall
+	bool lookup(const char* token, const unsigned length,
+	            const SymbolTable& tokens, TokenId& id) const
+	{
+		if(tokens.find(token,length,id))
+		{
+			return true;
+		}
+		if(!fold_case)
+		{
+			return false;
+		}
+		std::string lower(token,length);
+		for(std::string::iterator i = lower.begin(); i != lower.end(); ++i)
+		{
+			*i = std::tolower(static_cast<unsigned char>(*i));
+		}
+		return tokens.find(lower.data(),length,id);
+	}
+};
+
+#endif
@@ -19,127 +19,475 @@
 #ifndef __WEGEL_TDBP_WISHTREE_HPP__
 #define __WEGEL_TDBP_WISHTREE_HPP__
 
-#include <sstream>
 #include <string>
-#include <map>
+#include <vector>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_set.hpp>
 #include "globaltypes.hpp"
+#include "symboltable.hpp"
+#include "persistentlist.hpp"
 
 /// Parsebaum
 /** Baum, dem Knoten hinzugefügt werden können und der als String im
-  * Wishtree/Showtree-Format ausgegeben werden kann.
+  * Wishtree/Showtree-Format ausgegeben werden kann. Der Baum ist
+  * unveränderlich und speichert die Schritte seiner Linksableitung als
+  * Liste mit geteiltem Rest: Jeder erweiterte Baum teilt alle bisherigen
+  * Knoten mit dem Baum, aus dem er entstanden ist, und kostet nur einen
+  * weiteren Schritt.
+  *
+  * Jeder Schritt trägt den Fingerabdruck der Ableitung bis zu ihm. Der
+  * Abdruck eines Baumes steht so ohne Ausgabe als String in konstanter
+  * Zeit bereit, und gleiche Bäume lassen sich erkennen, bevor sie je
+  * ausgegeben werden.
+  *
+  * Ein bereits abgeleiteter Teilbaum kann als Abschnitt (Segment) in
+  * einem einzigen Schritt an einen anderen Baum angehängt werden. Der
+  * Abdruck ist ein Polynom über die Schritte, sodass der angehängte Baum
+  * denselben Abdruck hat, als wären die Schritte einzeln hinzugefügt
+  * worden.
   */
 class WishTree
 {
-	private:
+	public:
 
 	////////////////////////////////////////////////////////////////////////
 	// Typen
 
-	/// Äste als Map Symbolinstanz -> Liste von Symbolinstanzen
-	typedef std::map<SymbolInstance,SymbolInstanceList> Edges;
+	class Segment;
+
+	private:
+
+	/// Schritt der Linksableitung: Expansion eines Symbols oder Abschnitt
+	/** Symbole und Tokens sind Indizes, Regeln verweisen in die flachen
+	  * Felder der übersetzten Grammatik, die den Baum überleben muss. Ein
+	  * Schritt mit Abschnitt steht für alle Schritte des Abschnitts.
+	  */
+	struct Step
+	{
+		SymbolId		symbol;		///< Expandiertes Symbol
+		const SymbolId*	rule;		///< Rechte Regelseite oder 0
+		unsigned		length;		///< Länge der rechten Regelseite
+		TokenId			token;		///< Terminal, falls rule 0 ist
+		const Segment*	segment;	///< Angehängter Abschnitt oder 0
+		unsigned		count;		///< Einzelschritte bis einschließlich hier
+		boost::uint64_t	hash;		///< Fingerabdruck bis einschließlich hier
+
+		/// Konstruktor aus Symbol, Regel, Terminal und bisherigem Abdruck
+		/** Mischt Symbol, rechte Regelseite bzw. Terminal zu einem Wert und
+		  * hängt ihn an den Abdruck der vorangehenden Schritte an. Gleiche
+		  * Bäume haben gleiche Abdrücke, auch wenn sie über verschiedene,
+		  * aber gleichlautende Regeln abgeleitet wurden.
+		  */
+		Step(const SymbolId s, const SymbolId* r, const unsigned l,
+		     const TokenId t, const unsigned n, const boost::uint64_t previous)
+		{
+			symbol = s;
+			rule = r;
+			length = l;
+			token = t;
+			segment = 0;
+			count = n;
+			boost::uint64_t value = 14695981039346656037ULL;
+			mix(value,symbol);
+			if(rule == 0)
+			{
+				// Markiere Terminale, damit sie sich von Regeln unterscheiden
+				mix(value,~0u);
+				mix(value,token);
+			}
+			else
+			{
+				mix(value,length);
+				for(unsigned c = 0; c < length; ++c)
+				{
+					mix(value,rule[c]);
+				}
+			}
+			hash = previous*1099511628211ULL+value;
+		}
+
+		/// Konstruktor aus einem Abschnitt, Schrittzahl und Abdruck
+		Step(const Segment* s, const unsigned n, const boost::uint64_t h)
+		{
+			symbol = 0;
+			rule = 0;
+			length = 0;
+			token = 0;
+			segment = s;
+			count = n;
+			hash = h;
+		}
 
-	/// Einzelner Ast als Paar Symbolinstanz, Liste von Symbolinstanzen
-	typedef std::pair<SymbolInstance,SymbolInstanceList> Edge;
+		/// Vergleicht zwei Schritte nach Symbol, Regelseite und Terminal
+		/** Nur für Schritte ohne Abschnitt.
+		  */
+		bool operator==(const Step& other) const
+		{
+			if(symbol != other.symbol || (rule == 0) != (other.rule == 0))
+			{
+				return false;
+			}
+			if(rule == 0)
+			{
+				return token == other.token;
+			}
+			return length == other.length &&
+			       std::equal(rule,rule+length,other.rule);
+		}
+	};
+
+	/// Schritte, der jüngste zuerst
+	typedef PersistentList<Step> Steps;
+
+	/// Schritte in der Reihenfolge der Ableitung
+	typedef std::vector<const Step*> StepSequence;
 
 	public:
 
+	/// Abschnitt eines Baumes, der an andere Bäume angehängt werden kann
+	/** Hält die Schritte, um die ein Baum über einen früheren Stand hinaus
+	  * gewachsen ist, etwa die Ableitung eines Teilbaumes. Bäume, an die der
+	  * Abschnitt angehängt wird, verweisen nur auf ihn; er muss sie
+	  * überleben.
+	  */
+	class Segment
+	{
+		public:
+
+		/// Konstruktor aus einem Baum und einem früheren Stand desselben
+		/** @param whole Baum
+		    @param before Früherer Stand, aus dem whole entstanden ist
+		  */
+		Segment(const WishTree& whole, const WishTree& before)
+			: top(whole.steps)
+		{
+			stop = before.count();
+			length = whole.count()-stop;
+			scale = power(length);
+			hash = whole.fingerprint()-before.fingerprint()*scale;
+		}
+
+		/// Liefert den Fingerabdruck des Abschnitts allein
+		boost::uint64_t fingerprint() const
+		{
+			return hash;
+		}
+
+		/// Vergleicht zwei Abschnitte nach ihren Einzelschritten
+		bool operator==(const Segment& other) const
+		{
+			if(hash != other.hash || length != other.length)
+			{
+				return false;
+			}
+			StepSequence mine;
+			StepSequence theirs;
+			collect(top.begin(),stop,mine);
+			collect(other.top.begin(),other.stop,theirs);
+			for(unsigned i = 0; i < mine.size(); ++i)
+			{
+				if(mine[i] != theirs[i] && !(*mine[i] == *theirs[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		private:
+
+		friend class WishTree;
+
+		Steps top;				///< Jüngster Schritt des Abschnitts
+		unsigned stop;			///< Einzelschritte vor dem Abschnitt
+		unsigned length;		///< Einzelschritte im Abschnitt
+		boost::uint64_t hash;	///< Abdruck des Abschnitts allein
+		boost::uint64_t scale;	///< Basis des Abdrucks hoch length
+	};
+	friend class Segment;
+
+	/// Ausgabe von Bäumen in einen wiederverwendeten Puffer
+	/** Schreibt einen Baum in einem einzigen Durchlauf über seine Schritte
+	  * in Präordnung. Die Länge des Strings wird vorher berechnet und der
+	  * Puffer einmal passend reserviert; da Puffer und Hilfsfelder von Baum
+	  * zu Baum erhalten bleiben, wird nach den ersten Bäumen gar kein
+	  * Speicher mehr angelegt.
+	  */
+	class Writer
+	{
+		public:
+
+		/// Schreibt einen Baum in den Puffer
+		/** @param tree Baum
+		    @param symbols Namen der Symbole
+		    @param tokens Namen der Terminale
+		    @return Puffer mit dem Baum als String, gültig bis zum nächsten
+		            Aufruf
+		  */
+		const std::string& write(const WishTree& tree,
+		                         const SymbolTable& symbols,
+		                         const SymbolTable& tokens)
+		{
+			// Bringe die Schritte in die Reihenfolge der Ableitung und
+			// berechne dabei die Länge des Strings
+			sequence.clear();
+			tree.flatten(sequence);
+			std::size_t length = 0;
+			for(StepSequence::const_iterator i = sequence.begin();
+			    i != sequence.end(); ++i)
+			{
+				const Step& step = **i;
+				// Symbol, "/[" und "]"
+				length += symbols.name_length(step.symbol)+3;
+				if(step.rule == 0)
+				{
+					// "-" und Terminal
+					length += tokens.name_length(step.token)+1;
+				}
+				else if(step.length > 0)
+				{
+					// Kommas zwischen den Tochterknoten
+					length += step.length-1;
+				}
+			}
+			buffer.clear();
+			buffer.reserve(length);
+
+			// Jeder Schritt öffnet den Knoten seines Symbols. Auf dem Stapel
+			// steht für jeden offenen Knoten die Zahl seiner noch nicht
+			// geschlossenen Tochterknoten.
+			open.clear();
+			for(StepSequence::reverse_iterator i = sequence.rbegin();
+			    i != sequence.rend(); ++i)
+			{
+				const Step& step = **i;
+				symbols.append_name(buffer,step.symbol);
+				buffer += "/[";
+				if(step.rule == 0)
+				{
+					// Tochterknoten ist ein Terminal
+					buffer += '-';
+					tokens.append_name(buffer,step.token);
+				}
+				else if(step.length > 0)
+				{
+					open.push_back(step.length);
+					continue;
+				}
+				// Knoten ist vollständig, schließe ihn und alle Vorfahren,
+				// deren letzte Tochter er ist
+				buffer += ']';
+				while(!open.empty())
+				{
+					if(--open.back() > 0)
+					{
+						buffer += ',';
+						break;
+					}
+					buffer += ']';
+					open.pop_back();
+				}
+			}
+			return buffer;
+		}
+
+		private:
+
+		StepSequence sequence;		///< Schritte, der jüngste zuerst
+		std::vector<unsigned> open;	///< Offene Knoten -> offene Töchter
+		std::string buffer;			///< Ausgabe
+	};
+	friend class Writer;
+
 	////////////////////////////////////////////////////////////////////////
 	// Öffentliche Funktionen
 
 	/// Konstruktor eines leeren Baumes
-	/** Initialisiert einen Baum ohne Knoten und Äste, der aber sein
-	  * künftiges Startsymbol bereits kennt.
-	    @param si Symbolinstanz, die den obersten Knoten bilden wird
+	/** Initialisiert einen Baum ohne Knoten und Äste. Der erste
+	  * hinzugefügte Schritt bildet den obersten Knoten.
 	  */
-	WishTree(SymbolInstance si)
+	WishTree()
 	{
-		start = si;
 	}
 
 	/// Konstruktor, der einem Baum Nichtterminale hinzufügt
 	/** Initialisiert einen Baum auf Grundlage eines bestehenden Baumes.
-	  * Unter einer Symbolinstanz werden dabei Äste mit weiteren
-	  * Symbolinstanzen hinzugefügt.
+	  * Unter dem am weitesten links stehenden offenen Knoten werden dabei
+	  * Äste mit den Symbolen einer rechten Regelseite hinzugefügt.
 	    @param old_tree Bestehender Baum
-	    @param si Symbolinstanz, unter der Äste eingefügt werden
-	    @param si_list Liste der Symbolinstanzen, zu denen die Äste führen
+	    @param s Symbol, unter dem Äste eingefügt werden
+	    @param rule Rechte Regelseite, zu deren Symbolen die Äste führen
+	    @param length Länge der rechten Regelseite
 	  */
-	WishTree(WishTree old_tree, SymbolInstance si, SymbolInstanceList si_list)
+	WishTree(const WishTree& old_tree, const SymbolId s,
+	         const SymbolId* rule, const unsigned length)
+		: steps(Step(s,rule,length,0,old_tree.count()+1,old_tree.fingerprint()),
+		        old_tree.steps)
 	{
-		edges = old_tree.edges;
-		edges.insert(Edge(si,si_list));
-		start = old_tree.start;
 	}
 
 	/// Konstruktor, der einem Baum ein Terminal hinzufügt
 	/** Initialisiert einen Baum auf Grundlage eines bestehenden Baumes.
-	  * Unter einer Symbolinstanz wird dabei ein Ast mit einem Terminal
-	  * hinzugefügt.
+	  * Unter dem am weitesten links stehenden offenen Knoten wird dabei ein
+	  * Ast mit einem Terminal hinzugefügt.
 	    @param old_tree Bestehender Baum
-	    @param si Symbolinstanz, unter der der Ast eingefügt wird
+	    @param s Symbol, unter dem der Ast eingefügt wird
 	    @param t Terminal, zu dem der Ast führt
 	  */
-	WishTree(WishTree old_tree, SymbolInstance si, Token t)
+	WishTree(const WishTree& old_tree, const SymbolId s, const TokenId t)
+		: steps(Step(s,0,0,t,old_tree.count()+1,old_tree.fingerprint()),
+		        old_tree.steps)
+	{
+	}
+
+	/// Konstruktor, der einem Baum einen Abschnitt anhängt
+	/** Initialisiert einen Baum auf Grundlage eines bestehenden Baumes, dem
+	  * alle Schritte eines Abschnitts in einem Schritt hinzugefügt werden.
+	    @param old_tree Bestehender Baum
+	    @param segment Abschnitt, muss den neuen Baum überleben
+	  */
+	WishTree(const WishTree& old_tree, const Segment& segment)
+		: steps(Step(&segment,old_tree.count()+segment.length,
+		             old_tree.fingerprint()*segment.scale+segment.hash),
+		        old_tree.steps)
 	{
-		edges = old_tree.edges;
-		SymbolInstanceList si_list;
-		si_list.push_back(SymbolInstance('-'+t,-1));
-		edges.insert(Edge(si,si_list));
-		start = old_tree.start;
 	}
 
 	/// Gibt den Baum als String aus
-	/** Gibt den Baum als String im Wishtree/Showtree-Format aus.
+	/** Gibt den Baum als String im Wishtree/Showtree-Format aus. Für viele
+	  * Bäume ist ein wiederverwendeter Writer günstiger.
+	    @param symbols Namen der Symbole
+	    @param tokens Namen der Terminale
 	    @return Baum als String
 	  */
-	std::string str()
+	std::string str(const SymbolTable& symbols, const SymbolTable& tokens) const
+	{
+		Writer writer;
+		return writer.write(*this,symbols,tokens);
+	}
+
+	/// Liefert den Fingerabdruck des Baumes, ohne ihn auszugeben
+	/** Der Abdruck wurde beim Aufbau des Baumes Schritt für Schritt
+	  * berechnet und steht im jüngsten Schritt.
+	    @return Fingerabdruck
+	  */
+	boost::uint64_t fingerprint() const
 	{
-		return str_recursive(start);
+		return steps.empty() ? 0 : steps.front().hash;
+	}
+
+	/// Vergleicht zwei Bäume
+	/** Vergleicht zuerst die Fingerabdrücke und nur bei gleichen Abdrücken
+	  * die Einzelschritte selbst.
+	  */
+	bool operator==(const WishTree& other) const
+	{
+		if(fingerprint() != other.fingerprint() || count() != other.count())
+		{
+			return false;
+		}
+		if(steps.begin() == other.steps.begin())
+		{
+			return true;
+		}
+		StepSequence mine;
+		StepSequence theirs;
+		flatten(mine);
+		other.flatten(theirs);
+		for(unsigned i = 0; i < mine.size(); ++i)
+		{
+			if(mine[i] != theirs[i] && !(*mine[i] == *theirs[i]))
+			{
+				return false;
+			}
+		}
+		return true;
 	}
 
+	/// Hashfunktion für Mengen von Bäumen
+	struct Hash
+	{
+		std::size_t operator()(const WishTree& tree) const
+		{
+			return static_cast<std::size_t>(tree.fingerprint());
+		}
+	};
+
 	private:
 
 	////////////////////////////////////////////////////////////////////////
 	// Daten
 
-	Edges edges;			///< Äste des Baumes
-	SymbolInstance start;	///< Oberster Knoten des Baumes
+	Steps steps;	///< Schritte der Linksableitung, der jüngste zuerst
 
 	////////////////////////////////////////////////////////////////////////
 	// Private Funktionen
 
-	/// Baut den String rekursiv auf
-	/** Erstellt rekursiv den String zum Teilbaum, der unter einer bestimmten
-	  * Symbolinstanz hängt.
-	    @param si Symbolinstanz, deren Teilbaum ausgegeben wird
-	    @return Teilbaum als String
+	/// Zahl der Einzelschritte im Baum
+	unsigned count() const
+	{
+		return steps.empty() ? 0 : steps.front().count;
+	}
+
+	/// Sammelt die Einzelschritte, der jüngste zuerst
+	/** Abschnitte werden dabei durch ihre Schritte ersetzt.
+	    @param sequence Ausgabe der Schritte
 	  */
-	std::string str_recursive(SymbolInstance si)
-	{
-		std::stringstream s;
-		// Gib aus: Symbol des obersten Knotens, Klammer auf
-		s << si.symbol << "/[";
-		// Durchsuche die Tochterknoten
-		SymbolInstanceList& children = edges[si];
-		SymbolInstanceList::const_iterator c = children.begin();
-		if(c->id == -1)
+	void flatten(StepSequence& sequence) const
+	{
+		collect(steps.begin(),0,sequence);
+	}
+
+	/// Sammelt Einzelschritte bis zu einer Zahl vorangehender Schritte
+	/** @param i Jüngster Schritt
+	    @param stop Zahl der Einzelschritte, die nicht mehr gesammelt werden
+	    @param sequence Ausgabe der Schritte
+	  */
+	static void collect(Steps::const_iterator i, const unsigned stop,
+	                    StepSequence& sequence)
+	{
+		for(; i != Steps::const_iterator() && i->count > stop; ++i)
 		{
-			// Tochterknoten ist ein Terminal, gib es aus
-			s << c->symbol;
+			if(i->segment != 0)
+			{
+				collect(i->segment->top.begin(),i->segment->stop,sequence);
+			}
+			else
+			{
+				sequence.push_back(&*i);
+			}
 		}
-		else
+	}
+
+	/// Berechnet eine Potenz der Basis, mit der Schritte angehängt werden
+	static boost::uint64_t power(unsigned exponent)
+	{
+		boost::uint64_t result = 1;
+		boost::uint64_t factor = 1099511628211ULL;
+		for(; exponent > 0; exponent >>= 1)
 		{
-			// Gib die Teilbäume der Tochterknoten rekursiv aus
-			s << str_recursive(*c);
-			for(++c; c != children.end(); ++c)
+			if(exponent & 1)
 			{
-				s << ',' << str_recursive(*c);
+				result *= factor;
 			}
+			factor *= factor;
+		}
+		return result;
+	}
+
+	/// Mischt einen Wert in einen Fingerabdruck (FNV-1a über 32 Bit)
+	static void mix(boost::uint64_t& hash, const unsigned value)
+	{
+		for(unsigned b = 0; b < 4; ++b)
+		{
+			hash ^= (value >> (8*b)) & 0xff;
+			hash *= 1099511628211ULL;
 		}
-		// Gib aus: Klammer zu
-		s << ']';
-		return s.str();
 	}
 };
 
+/// Menge von Bäumen, doppelte Bäume über ihre Struktur erkannt
+typedef boost::unordered_set<WishTree,WishTree::Hash> WishTreeSet;
+
 #endif
@@ -0,0 +1,557 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// bench.cpp
+// Misst den Parser mit synthetischen Grammatiken über steigende Satzlängen
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "../include/tdbp.hpp"
+
+/// Gibt die Verwendungsinformation aus und beendet das Programm
+void usage()
+{
+	std::cerr << "Benchmark fuer tdbp mit synthetischen Grammatiken\n\n"
+	<< "Verwendung: tdbp-bench [Optionen] <Verzeichnis> <Ergebnis>\n"
+	<< "<Verzeichnis>: Ablage fuer die erzeugten Grammatiken und Lexika\n"
+	<< "<Ergebnis>: Tabelle mit den Messwerten, - fuer die Standardausgabe\n\n"
+	<< "Optionen:\n"
+	<< "-w <Anzahl>: Woerter pro Lexikon (Standard 1000)\n"
+	<< "-l <Von>:<Bis>:<Schritt>: Satzlaengen in Tokens (Standard 5:60:5)\n"
+	<< "-u <Tiefe>: Laenge der unaeren Ketten (Standard 40)\n"
+	<< "-r <Anzahl>: Wiederholungen pro Satz, gemessen wird die\n"
+	<< "    schnellste (Standard 3)\n"
+	<< "-t <Sekunden>: laengere Saetze einer Grammatik auslassen, sobald\n"
+	<< "    ein Satz so lange braucht (Standard 2)\n"
+	<< "-n <Anzahl>: laengere Saetze einer Grammatik auslassen, sobald\n"
+	<< "    ein Satz mehr Baeume hat (Standard 100000)\n"
+	<< "-e <Verfahren>: backtracking (Standard), earley oder cyk\n"
+	<< "-m: Backtracking mit Tabelle abgeschlossener Teilbaeume\n";
+	// Programm beenden
+	exit(1);
+}
+
+/// Einstellungen eines Laufs
+struct Settings
+{
+	unsigned words;				///< Wörter pro Lexikon
+	unsigned shortest;			///< Kürzeste Satzlänge
+	unsigned longest;			///< Längste Satzlänge
+	unsigned step;				///< Abstand der Satzlängen
+	unsigned depth;				///< Länge der unären Ketten
+	unsigned repeat;			///< Wiederholungen pro Satz
+	double budget;				///< Zeitgrenze pro Satz in Sekunden
+	unsigned max_trees;			///< Baumgrenze pro Satz
+	TDBParser::Engine engine;	///< Verfahren
+	std::string engine_name;	///< Name des Verfahrens
+	bool memo;					///< Tabelle ja/nein
+};
+
+/// Kategorie des Lexikons mit ihrem Anteil an den Wörtern
+struct Category
+{
+	std::string name;	///< Präterminal, zugleich Präfix der Wörter
+	unsigned share;		///< Anteil an den Wörtern in Prozent
+};
+
+/// Liste der Kategorien eines Lexikons
+typedef std::vector<Category> CategoryList;
+
+/// Synthetische Grammatik mit bekanntem Wachstum der Mehrdeutigkeit
+/** Jede Familie schreibt ihre Grammatik und nennt die Kategorien ihres
+  * Lexikons; zu jeder Länge bildet sie einen Satz mit genau so vielen
+  * Tokens.
+  */
+class Family
+{
+	public:
+
+	/// Destruktor
+	virtual ~Family()
+	{
+	}
+
+	/// Name der Familie, zugleich Dateiname
+	virtual std::string name() const = 0;
+
+	/// Schreibt die Grammatik
+	virtual void grammar(std::ostream& out) const = 0;
+
+	/// Kategorien des Lexikons
+	virtual CategoryList categories() const = 0;
+
+	/// Bildet einen Satz aus Kategorien mit der gewünschten Zahl an Tokens
+	virtual std::vector<std::string> sentence(const unsigned length) const = 0;
+
+	protected:
+
+	/// Hängt eine Kategorie an eine Liste an
+	static void add(CategoryList& list, const std::string& name,
+	                const unsigned share)
+	{
+		Category c;
+		c.name = name;
+		c.share = share;
+		list.push_back(c);
+	}
+};
+
+/// PP-Anbindung: die Zahl der Bäume wächst mit den Catalan-Zahlen
+/** Jede Präpositionalphrase kann an das Verb oder an jedes vorangehende
+  * Nomen angebunden werden, ohne dass sich Äste kreuzen. Ein Satz
+  * "n v n" mit k folgenden Präpositionalphrasen hat C(k+1) Bäume, bei
+  * 60 Tokens weit mehr, als sich aufzählen lassen.
+  */
+class Attachment : public Family
+{
+	public:
+
+	std::string name() const
+	{
+		return "pp";
+	}
+
+	void grammar(std::ostream& out) const
+	{
+		out << "% PP-Anbindung, Catalan-Mehrdeutigkeit\n"
+		    << "s --> np, vp.\n"
+		    << "np --> n.\n"
+		    << "np --> det, n.\n"
+		    << "np --> n, pps.\n"
+		    << "np --> det, n, pps.\n"
+		    << "pps --> pp.\n"
+		    << "pps --> pp, pps.\n"
+		    << "pp --> p, np.\n"
+		    << "vp --> v, np.\n"
+		    << "vp --> v, np, pps.\n";
+	}
+
+	CategoryList categories() const
+	{
+		CategoryList list;
+		add(list,"det",5);
+		add(list,"n",60);
+		add(list,"v",25);
+		add(list,"p",10);
+		return list;
+	}
+
+	std::vector<std::string> sentence(const unsigned length) const
+	{
+		// "n v n", bei ungerader Restlänge mit Artikel, dann "p n"
+		std::vector<std::string> s;
+		unsigned rest = length-3;
+		if(rest % 2 == 1)
+		{
+			s.push_back("det");
+			--rest;
+		}
+		s.push_back("n");
+		s.push_back("v");
+		s.push_back("n");
+		for(; rest > 0; rest -= 2)
+		{
+			s.push_back("p");
+			s.push_back("n");
+		}
+		return s;
+	}
+};
+
+/// Tiefe unäre Ketten: ein Baum, aber viele Expansionen pro Token
+/** Jedes Token wird über eine Kette einstelliger Regeln abgeleitet, die
+  * Suche geht also pro Token so tief wie die Kette lang ist.
+  */
+class Chain : public Family
+{
+	public:
+
+	/// Konstruktor aus der Länge der Ketten
+	Chain(const unsigned d)
+		: depth(d)
+	{
+	}
+
+	std::string name() const
+	{
+		return "kette";
+	}
+
+	void grammar(std::ostream& out) const
+	{
+		out << "% Unaere Ketten der Laenge " << depth << "\n"
+		    << "s --> " << link(0) << ", s.\n"
+		    << "s --> " << link(0) << ".\n";
+		for(unsigned i = 0; i+1 < depth; ++i)
+		{
+			out << link(i) << " --> " << link(i+1) << ".\n";
+		}
+		out << link(depth-1) << " --> k.\n";
+	}
+
+	CategoryList categories() const
+	{
+		CategoryList list;
+		add(list,"k",100);
+		return list;
+	}
+
+	std::vector<std::string> sentence(const unsigned length) const
+	{
+		return std::vector<std::string>(length,"k");
+	}
+
+	private:
+
+	unsigned depth;	///< Länge der Ketten
+
+	/// Name des i-ten Glieds, Symbole bestehen nur aus Buchstaben
+	static std::string link(unsigned i)
+	{
+		std::string name;
+		do
+		{
+			name += char('a'+i%26);
+			i /= 26;
+		}
+		while(i > 0);
+		return "u"+name;
+	}
+};
+
+/// Breite flache Regeln: ein Baum, aber viele lange Alternativen
+/** Das Startsymbol hat für jede Länge bis zur längsten Satzlänge eine
+  * Regel aus ebenso vielen gleichen Präterminalen.
+  */
+class Flat : public Family
+{
+	public:
+
+	/// Konstruktor aus der größten Regellänge
+	Flat(const unsigned w)
+		: width(w)
+	{
+	}
+
+	std::string name() const
+	{
+		return "flach";
+	}
+
+	void grammar(std::ostream& out) const
+	{
+		out << "% Flache Regeln bis zur Breite " << width << "\n";
+		for(unsigned n = 1; n <= width; ++n)
+		{
+			out << "s --> k";
+			for(unsigned i = 1; i < n; ++i)
+			{
+				out << ", k";
+			}
+			out << ".\n";
+		}
+	}
+
+	CategoryList categories() const
+	{
+		CategoryList list;
+		add(list,"k",100);
+		return list;
+	}
+
+	std::vector<std::string> sentence(const unsigned length) const
+	{
+		return std::vector<std::string>(length,"k");
+	}
+
+	private:
+
+	unsigned width;	///< Größte Regellänge
+};
+
+/// Liste der Grammatikfamilien
+typedef std::vector<boost::shared_ptr<Family> > FamilyList;
+
+/// Anzahl der Wörter einer Kategorie im Lexikon
+unsigned category_words(const Category& category, const Settings& settings)
+{
+	const unsigned n = settings.words*category.share/100;
+	return n > 0 ? n : 1;
+}
+
+/// Schreibt Grammatik und Lexikon einer Familie
+/** @param family Familie
+    @param settings Einstellungen mit der Größe des Lexikons
+    @param grammarfile Dateiname der Grammatik
+    @param lexiconfile Dateiname des Lexikons
+    @return Dateien geschrieben ja/nein
+  */
+bool write_sources(const Family& family, const Settings& settings,
+                   const std::string& grammarfile,
+                   const std::string& lexiconfile)
+{
+	std::ofstream grammar(grammarfile.c_str());
+	family.grammar(grammar);
+
+	// Jedes Wort heißt wie seine Kategorie mit angehängter Nummer
+	std::ofstream lexicon(lexiconfile.c_str());
+	const CategoryList categories = family.categories();
+	for(CategoryList::const_iterator c = categories.begin();
+	    c != categories.end(); ++c)
+	{
+		const unsigned n = category_words(*c,settings);
+		for(unsigned i = 0; i < n; ++i)
+		{
+			lexicon << c->name << " --> " << c->name << i << ".\n";
+		}
+	}
+	return grammar && lexicon;
+}
+
+/// Bildet den Satz einer Familie mit Wörtern aus ihrem Lexikon
+/** Die Wörter werden über das ganze Lexikon gestreut, aber
+  * reproduzierbar gewählt.
+    @param family Familie
+    @param settings Einstellungen mit der Größe des Lexikons
+    @param length Zahl der Tokens
+    @return Satz
+  */
+std::string make_sentence(const Family& family, const Settings& settings,
+                          const unsigned length)
+{
+	const CategoryList categories = family.categories();
+	const std::vector<std::string> pattern = family.sentence(length);
+	std::ostringstream out;
+	for(unsigned i = 0; i < pattern.size(); ++i)
+	{
+		unsigned n = 1;
+		for(CategoryList::const_iterator c = categories.begin();
+		    c != categories.end(); ++c)
+		{
+			if(c->name == pattern[i])
+			{
+				n = category_words(*c,settings);
+			}
+		}
+		out << (i > 0 ? " " : "") << pattern[i] << (i*7919+13) % n;
+	}
+	return out.str();
+}
+
+/// Misst alle Satzlängen einer Familie
+/** Schreibt pro Satzlänge eine Zeile der Tabelle. Braucht ein Satz länger
+  * als die Zeitgrenze oder hat er mehr Bäume als die Baumgrenze, werden
+  * die längeren Sätze der Familie ausgelassen.
+    @param family Familie
+    @param settings Einstellungen
+    @param directory Ablage für Grammatik und Lexikon
+    @param out Tabelle
+    @return Grammatik und Lexikon erzeugt und geladen ja/nein
+  */
+bool measure(const Family& family, const Settings& settings,
+             const std::string& directory, std::ostream& out)
+{
+	const std::string grammarfile = directory+"/"+family.name()+".pl";
+	const std::string lexiconfile = directory+"/"+family.name()+"-lexikon.pl";
+	if(!write_sources(family,settings,grammarfile,lexiconfile))
+	{
+		std::cerr << "Grammatik '" << grammarfile << "' kann nicht geschrieben "
+		          << "werden.\n";
+		return false;
+	}
+
+	// Lade Grammatik und Lexikon
+	const boost::posix_time::ptime start =
+		boost::posix_time::microsec_clock::universal_time();
+	TDBParser parser(grammarfile,lexiconfile,settings.engine);
+	const long load = (boost::posix_time::microsec_clock::universal_time()-
+	                   start).total_microseconds();
+	parser.set_memo(settings.memo);
+
+	TDBParser::Session session;
+	for(unsigned length = settings.shortest; length <= settings.longest;
+	    length += settings.step)
+	{
+		const std::string sentence = make_sentence(family,settings,length);
+		TDBParser::Timings best = {0,0,0};
+		unsigned trees = 0;
+		for(unsigned r = 0; r < settings.repeat; ++r)
+		{
+			std::string output;
+			std::string log;
+			TDBParser::Timings timings;
+			if(!parser.parse_string(sentence,session,output,log,&timings))
+			{
+				std::cerr << log << "\n";
+				return false;
+			}
+			trees = 0;
+			for(std::string::const_iterator c = output.begin();
+			    c != output.end(); ++c)
+			{
+				trees += *c == '\n';
+			}
+			if(r == 0 || timings.tokenize < best.tokenize)
+			{
+				best.tokenize = timings.tokenize;
+			}
+			if(r == 0 || timings.search < best.search)
+			{
+				best.search = timings.search;
+			}
+			if(r == 0 || timings.serialize < best.serialize)
+			{
+				best.serialize = timings.serialize;
+			}
+		}
+
+		out << family.name() << "\t" << settings.engine_name << "\t"
+		    << (settings.memo ? 1 : 0) << "\t" << settings.words << "\t"
+		    << length << "\t" << trees << "\t" << load << "\t"
+		    << best.tokenize << "\t" << best.search << "\t"
+		    << best.serialize << "\n";
+		out.flush();
+		std::cerr << family.name() << ", " << length << " Tokens: " << trees
+		          << " Baeume\n";
+
+		const double seconds =
+			(best.tokenize+best.search+best.serialize)/1000000.0;
+		if(seconds > settings.budget || trees > settings.max_trees)
+		{
+			if(length+settings.step <= settings.longest)
+			{
+				std::cerr << family.name() << ": laengere Saetze ausgelassen\n";
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+int main(int argc, const char* argv[])
+{
+	// Lies die Optionen vor den Parametern
+	Settings settings;
+	settings.words = 1000;
+	settings.shortest = 5;
+	settings.longest = 60;
+	settings.step = 5;
+	settings.depth = 40;
+	settings.repeat = 3;
+	settings.budget = 2;
+	settings.max_trees = 100000;
+	settings.engine = TDBParser::BACKTRACKING;
+	settings.engine_name = "backtracking";
+	settings.memo = false;
+	int arg = 1;
+	for(; arg < argc && argv[arg][0] == '-' && argv[arg][1] != 0; ++arg)
+	{
+		std::string option(argv[arg]);
+		if(option == "-m")
+		{
+			settings.memo = true;
+		}
+		else if(option == "-w" && arg+1 < argc)
+		{
+			settings.words = std::atoi(argv[++arg]);
+		}
+		else if(option == "-l" && arg+1 < argc)
+		{
+			if(std::sscanf(argv[++arg],"%u:%u:%u",&settings.shortest,
+			               &settings.longest,&settings.step) != 3 ||
+			   settings.shortest < 3 || settings.step == 0)
+			{
+				usage();
+			}
+		}
+		else if(option == "-u" && arg+1 < argc)
+		{
+			settings.depth = std::atoi(argv[++arg]);
+		}
+		else if(option == "-r" && arg+1 < argc)
+		{
+			settings.repeat = std::atoi(argv[++arg]);
+		}
+		else if(option == "-t" && arg+1 < argc)
+		{
+			settings.budget = std::atof(argv[++arg]);
+		}
+		else if(option == "-n" && arg+1 < argc)
+		{
+			settings.max_trees = std::atoi(argv[++arg]);
+		}
+		else if(option == "-e" && arg+1 < argc)
+		{
+			settings.engine_name = argv[++arg];
+			if(settings.engine_name == "backtracking")
+				settings.engine = TDBParser::BACKTRACKING;
+			else if(settings.engine_name == "earley")
+				settings.engine = TDBParser::EARLEY;
+			else if(settings.engine_name == "cyk")
+				settings.engine = TDBParser::CYK;
+			else usage();
+		}
+		else
+		{
+			// Unbekannte Option
+			usage();
+		}
+	}
+	if(argc-arg != 2 || settings.words == 0 || settings.repeat == 0 ||
+	   settings.depth == 0)
+	{
+		// Keine gültige Anzahl von Parametern
+		usage();
+	}
+	const std::string directory(argv[arg]);
+	const std::string target(argv[arg+1]);
+
+	std::ofstream file;
+	if(target != "-")
+	{
+		file.open(target.c_str());
+		if(!file)
+		{
+			std::cerr << "Ergebnis '" << target << "' kann nicht geschrieben "
+			          << "werden.\n";
+			return 1;
+		}
+	}
+	std::ostream& out = target == "-" ? std::cout : file;
+
+	// Eine Zeile pro Familie und Satzlänge, Zeiten in Mikrosekunden
+	out << "grammatik\tverfahren\ttabelle\twoerter\ttokens\tbaeume\t"
+	    << "laden_us\ttokenisieren_us\tsuchen_us\tausgeben_us\n";
+	FamilyList families;
+	families.push_back(boost::shared_ptr<Family>(new Attachment()));
+	families.push_back(boost::shared_ptr<Family>(new Chain(settings.depth)));
+	families.push_back(boost::shared_ptr<Family>(new Flat(settings.longest)));
+	for(FamilyList::const_iterator f = families.begin(); f != families.end();
+	    ++f)
+	{
+		if(!measure(**f,settings,directory,out))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// expand.cpp
+// Zählt die Bäume gespeicherter Parsewälder auf
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include "../include/globaltypes.hpp"
+#include "../include/symboltable.hpp"
+#include "../include/forest.hpp"
+
+/// Gibt die Verwendungsinformation aus und beendet das Programm
+void usage()
+{
+	std::cerr << "Aufzaehler fuer gepackte Parsewaelder\n\n"
+	<< "Verwendung: tdbp-expand <Wald-Datei> <Baum-Ziel>\n"
+	<< "<Wald-Datei>: mit tdbp -f geschriebene Waelder\n"
+	<< "<Baum-Ziel>: Speicherort fuer Textdatei mit Baeumen\n"
+	<< "Fuer beide Dateien steht - fuer die Standardein- bzw. -ausgabe.\n";
+	// Programm beenden
+	exit(1);
+}
+
+/// Zählt die Bäume aller Wälder einer Eingabe auf
+/** Kopfzeilen des Stapelbetriebs werden unverändert übernommen, jeder Wald
+  * wird durch seine sortierten Bäume ersetzt. Die Ausgabe gleicht damit
+  * der von tdbp ohne -f.
+    @param in Eingabe mit Wäldern
+    @param out Ausgabe für Bäume
+    @return Eingabe fehlerfrei gelesen ja/nein
+  */
+bool expand(std::istream& in, std::ostream& out)
+{
+	while(in >> std::ws && in.peek() != EOF)
+	{
+		if(in.peek() == '%')
+		{
+			// Kopfzeile eines Satzes
+			std::string line;
+			std::getline(in,line);
+			out << line << "\n";
+			continue;
+		}
+		ParseForest forest;
+		SymbolTable symbols;
+		SymbolTable tokens;
+		if(!forest.read(in,symbols,tokens))
+		{
+			return false;
+		}
+		TreeSet trees;
+		forest.trees(trees,symbols,tokens,std::cerr);
+		for(TreeSet::const_iterator t = trees.begin(); t != trees.end(); ++t)
+		{
+			out << *t << "\n";
+		}
+	}
+	return true;
+}
+
+int main(int argc, const char* argv[])
+{
+	if(argc != 3)
+	{
+		// Keine gültige Anzahl von Parametern
+		usage();
+	}
+
+	std::string source(argv[1]);
+	std::string target(argv[2]);
+	std::ifstream infile;
+	std::ofstream outfile;
+	if(source != "-")
+	{
+		infile.open(source.c_str());
+		if(!infile.is_open())
+		{
+			std::cerr << "Wald-Datei '" << source
+			          << "' kann nicht gelesen werden.\n";
+			return 1;
+		}
+	}
+	if(target != "-")
+	{
+		outfile.open(target.c_str());
+		if(!outfile.is_open())
+		{
+			std::cerr << "Baum-Ziel '" << target
+			          << "' kann nicht geschrieben werden.\n";
+			return 1;
+		}
+	}
+	std::ostream& out = target == "-" ? std::cout : outfile;
+	if(!expand(source == "-" ? std::cin : infile,out))
+	{
+		std::cerr << "Wald-Datei '" << source << "' ist fehlerhaft.\n";
+		return 1;
+	}
+	if(!out.flush())
+	{
+		std::cerr << "Baum-Ziel '" << target
+		          << "' kann nicht geschrieben werden.\n";
+		return 1;
+	}
+	return 0;
+}
@@ -16,27 +16,255 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <limits>
 #include "../include/tdbp.hpp"
+#include "../include/server.hpp"
+
+/// Gibt die Verwendungsinformation aus und beendet das Programm
+void usage()
+{
+	std::cerr << "Top-Down-Backtracking-Parser\n\n"
+	<< "Verwendung: tdbp [Optionen] <Grammatik> <Lexikon> <Satz> <Baum-Ziel>\n"
+	<< "            tdbp [Optionen] -d|-u <Socket> <Grammatik> <Lexikon>\n"
+	<< "<Grammatik>: eine Prolog-DCG-Datei mit Produktionsregeln\n"
+	<< "<Lexikon>: eine Prolog-DCG-Datei mit Lexikonregeln\n"
+	<< "<Satz>: ein String, der tokenisiert und geparst werden soll\n"
+	<< "<Baum-Ziel>: Speicherort fuer Textdatei mit Baeumen\n\n"
+	<< "Optionen:\n"
+	<< "-e <Verfahren>: backtracking (Standard), earley oder cyk\n"
+	<< "-b: Stapelbetrieb, <Satz> ist eine Korpusdatei mit einem Satz pro\n"
+	<< "    Zeile, - steht fuer die Standardeingabe bzw. -ausgabe\n"
+	<< "-j <Anzahl>: Threads, 0 fuer alle Kerne (Standard 1)\n"
+	<< "-s: Baeume sofort beim Finden schreiben (Streaming)\n"
+	<< "-m: Backtracking merkt sich abgeschlossene Teilbaeume pro Symbol und\n"
+	<< "    Position und verwendet sie wieder (sucht dann in einem Thread)\n"
+	<< "-n <Anzahl>: nur die ersten <Anzahl> gefundenen Baeume ausgeben\n"
+	<< "-c: nur die Anzahl der Baeume ausgeben\n"
+	<< "-x: nur ausgeben, ob es einen Baum gibt (1 oder 0)\n"
+	<< "-f: gepackten Parsewald statt der Baeume schreiben, die Baeume\n"
+	<< "    erzeugt tdbp-expand daraus bei Bedarf\n"
+	<< "-k <Datei>: uebersetzte Grammatik in dieser Cache-Datei halten;\n"
+	<< "    ohne <Satz> und <Baum-Ziel> wird nur der Cache erzeugt\n"
+	<< "-p <Satzzeichen>: drop (Standard, trennen und entfallen), split\n"
+	<< "    (eigene Tokens) oder attach (gehoeren zum Wort)\n"
+	<< "-i: Woerter, die nicht im Lexikon stehen, klein geschrieben suchen\n"
+	<< "-d: als Server Anfragen zeilenweise von der Standardeingabe lesen\n"
+	<< "-u <Socket>: als Server Anfragen ueber diesen Unix-Socket annehmen\n";
+	// Programm beenden
+	exit(1);
+}
+
+/// Liest die Anzahl einer Option
+/** Beendet das Programm über usage(), wenn der Wert keine Zahl ist,
+  * negativ ist oder nicht in unsigned passt.
+    @param value Wert der Option
+    @return Anzahl
+  */
+unsigned parse_count(const char* value)
+{
+	char* end = 0;
+	errno = 0;
+	const long n = std::strtol(value,&end,10);
+	if(end == value || *end != 0 || errno == ERANGE || n < 0 ||
+	   static_cast<unsigned long>(n) > std::numeric_limits<unsigned>::max())
+	{
+		usage();
+	}
+	return unsigned(n);
+}
 
 int main(int argc, const char* argv[])
 {
-	if(argc != 5)
+	// Lies die Optionen vor den Parametern
+	TDBParser::Engine engine = TDBParser::BACKTRACKING;
+	bool batch = false;
+	unsigned threads = 1;
+	bool streaming = false;
+	bool memo = false;
+	TDBParser::Mode mode = TDBParser::ALL;
+	unsigned limit = 0;
+	std::string cache;
+	Tokenizer::Punctuation punctuation = Tokenizer::DROP;
+	bool fold_case = false;
+	bool server = false;
+	std::string socket;
+	int arg = 1;
+	for(; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		std::string option(argv[arg]);
+		if(option == "-b")
+		{
+			batch = true;
+		}
+		else if(option == "-s")
+		{
+			streaming = true;
+		}
+		else if(option == "-m")
+		{
+			memo = true;
+		}
+		else if(option == "-c")
+		{
+			mode = TDBParser::COUNT;
+		}
+		else if(option == "-x")
+		{
+			mode = TDBParser::EXISTS;
+		}
+		else if(option == "-f")
+		{
+			mode = TDBParser::FOREST;
+		}
+		else if(option == "-i")
+		{
+			fold_case = true;
+		}
+		else if(option == "-d")
+		{
+			server = true;
+		}
+		else if(option == "-u" && arg+1 < argc)
+		{
+			server = true;
+			socket = argv[++arg];
+		}
+		else if(option == "-n" && arg+1 < argc)
+		{
+			mode = TDBParser::FIRST;
+			limit = parse_count(argv[++arg]);
+			if(limit == 0)
+			{
+				usage();
+			}
+		}
+		else if(option == "-k" && arg+1 < argc)
+		{
+			cache = argv[++arg];
+		}
+		else if(option == "-j" && arg+1 < argc)
+		{
+			threads = parse_count(argv[++arg]);
+			if(threads == 0)
+			{
+				threads = boost::thread::hardware_concurrency();
+			}
+		}
+		else if(option == "-e" && arg+1 < argc)
+		{
+			std::string value(argv[++arg]);
+			if(value == "backtracking")	engine = TDBParser::BACKTRACKING;
+			else if(value == "earley")	engine = TDBParser::EARLEY;
+			else if(value == "cyk")		engine = TDBParser::CYK;
+			else usage();
+		}
+		else if(option == "-p" && arg+1 < argc)
+		{
+			std::string value(argv[++arg]);
+			if(value == "drop")			punctuation = Tokenizer::DROP;
+			else if(value == "split")	punctuation = Tokenizer::SPLIT;
+			else if(value == "attach")	punctuation = Tokenizer::ATTACH;
+			else usage();
+		}
+		else
+		{
+			// Unbekannte Option
+			usage();
+		}
+	}
+
+	if(argc-arg != 4 && (argc-arg != 2 || (cache.empty() && !server)))
 	{
 		// Keine gültige Anzahl von Parametern
-		// Verwendungsinformation ausgeben
-		std::cerr << "Top-Down-Backtracking-Parser\n\n"
-		<< "Verwendung: tdbp <Grammatik> <Lexikon> <Satz> <Baum-Ziel>\n"
-		<< "<Grammatik>: eine Prolog-DCG-Datei mit Produktionsregeln\n"
-		<< "<Lexikon>: eine Prolog-DCG-Datei mit Lexikonregeln\n"
-		<< "<Satz>: ein String, der tokenisiert und geparst werden soll\n"
-		<< "<Baum-Ziel>: Speicherort fuer Textdatei mit Baeumen\n";
-		// Programm beenden
-		exit(1);
+		usage();
+	}
+
+	if(server)
+	{
+		if(argc-arg != 2)
+		{
+			usage();
+		}
+		// Lade Grammatik und Lexikon einmal und beantworte Anfragen
+		boost::shared_ptr<TDBParser> parser(
+			new TDBParser(argv[arg],argv[arg+1],engine,cache));
+		parser->set_streaming(streaming);
+		parser->set_memo(memo);
+		parser->set_mode(mode,limit);
+		parser->set_tokenizer(Tokenizer(punctuation,fold_case));
+		ParserServer daemon(parser,argv[arg],argv[arg+1],cache);
+		if(socket.empty())
+		{
+			daemon.serve(std::cin,std::cout);
+			return 0;
+		}
+		std::string error;
+		daemon.listen(socket,error);
+		std::cerr << error;
+		return 1;
+	}
+
+	if(argc-arg == 2)
+	{
+		// Übersetze Grammatik und Lexikon nur in den Cache
+		if(!TDBParser::build_cache(cache,argv[arg],argv[arg+1]))
+		{
+			std::cerr << "Cache '" << cache
+			          << "' kann nicht geschrieben werden.\n";
+			return 1;
+		}
+		return 0;
 	}
 
 	// Erzeuge Instanz des Mustererkenners auf Basis von Grammatik und Lexikon
-	TDBParser parser(argv[1],argv[2]);
+	TDBParser parser(argv[arg],argv[arg+1],engine,cache);
+	parser.set_streaming(streaming);
+	parser.set_memo(memo);
+	parser.set_mode(mode,limit);
+	parser.set_tokenizer(Tokenizer(punctuation,fold_case));
+
+	if(batch)
+	{
+		// Parse das Korpus Zeile für Zeile
+		std::string corpus(argv[arg+2]);
+		std::string target(argv[arg+3]);
+		std::ifstream infile;
+		std::ofstream outfile;
+		if(corpus != "-")
+		{
+			infile.open(corpus.c_str());
+			if(!infile.is_open())
+			{
+				std::cerr << "Korpus '" << corpus
+				          << "' kann nicht gelesen werden.\n";
+				return 1;
+			}
+		}
+		if(target != "-")
+		{
+			outfile.open(target.c_str());
+			if(!outfile.is_open())
+			{
+				std::cerr << "Baum-Ziel '" << target
+				          << "' kann nicht geschrieben werden.\n";
+				return 1;
+			}
+		}
+		std::ostream& out = target == "-" ? std::cout : outfile;
+		parser.parse_corpus(corpus == "-" ? std::cin : infile,out,threads);
+		if(!out.flush())
+		{
+			std::cerr << "Baum-Ziel '" << target
+			          << "' kann nicht geschrieben werden.\n";
+			return 1;
+		}
+		return 0;
+	}
 
 	// Parse den Satz
-	parser.parse(argv[3],argv[4]);
+	parser.parse(argv[arg+2],argv[arg+3],threads);
 }
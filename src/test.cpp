@@ -0,0 +1,716 @@
+////////////////////////////////////////////////////////////////////////////////
+// Matthias Wegel, Oktober 2013
+//
+// Getestete Compiler:
+// Microsoft 32bit C/C++-Optimierungscompiler Version 16.00.30319.01
+//   mit Boost Version 1.54.0
+//   unter Microsoft Windows XP Professional 32bit Version 5.1.2600
+// g++ Version 4.6.3-1ubuntu5
+//   mit Boost Version 1.48.0.2
+//   unter Ubuntu 12.04.2 LTS, Precise Pangolin
+// g++ Version 4.7.3-1ubuntu10
+//   mit Boost Version 1.49.0.1
+//   unter Ubuntu 13.04 64bit
+//
+// test.cpp
+// Regressionstests des Parsers mit kleinen Grammatiken
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include "../include/tdbp.hpp"
+
+/// Gibt die Verwendungsinformation aus und beendet das Programm
+void usage()
+{
+	std::cerr << "Regressionstests fuer tdbp\n\n"
+	<< "Verwendung: tdbp-test <Verzeichnis>\n"
+	<< "<Verzeichnis>: Ablage fuer die erzeugten Grammatiken und Lexika\n";
+	// Programm beenden
+	exit(1);
+}
+
+/// Zähler der Prüfungen
+struct Results
+{
+	unsigned run;		///< Durchgeführte Prüfungen
+	unsigned failed;	///< Fehlgeschlagene Prüfungen
+};
+
+/// Zählt eine Prüfung und meldet sie, falls sie fehlschlägt
+/** @param ok Prüfung bestanden ja/nein
+    @param name Beschreibung der Prüfung
+    @param results Zähler
+  */
+void check(const bool ok, const std::string& name, Results& results)
+{
+	++results.run;
+	if(!ok)
+	{
+		++results.failed;
+		std::cerr << "FEHLER: " << name << "\n";
+	}
+}
+
+/// Schreibt einen Text in eine Datei
+/** @param filename Dateiname
+    @param text Inhalt
+    @return Datei geschrieben ja/nein
+  */
+bool write_file(const std::string& filename, const std::string& text)
+{
+	std::ofstream out(filename.c_str());
+	out << text;
+	return bool(out);
+}
+
+/// Liest eine Datei ganz ein
+std::string read_file(const std::string& filename)
+{
+	std::ifstream in(filename.c_str());
+	std::ostringstream text;
+	text << in.rdbuf();
+	return text.str();
+}
+
+/// Zählt die Zeilen eines Texts
+unsigned count_lines(const std::string& text)
+{
+	unsigned lines = 0;
+	for(std::string::const_iterator c = text.begin(); c != text.end(); ++c)
+	{
+		lines += *c == '\n';
+	}
+	return lines;
+}
+
+/// Parst einen Satz und liefert die Ausgabe, bei unbekannten Wörtern "?"
+std::string parse_with(const TDBParser& parser, const std::string& sentence)
+{
+	TDBParser::Session session;
+	std::string output;
+	std::string log;
+	if(!parser.parse_string(sentence,session,output,log))
+	{
+		return "?";
+	}
+	return output;
+}
+
+/// Vergleicht die Bäume mit und ohne Tabelle, gesammelt und gestreamt
+/** @param parser Parser, dessen Tabelle umgeschaltet wird
+    @param sentence Satz
+    @param name Beschreibung der Prüfung
+    @param results Zähler
+  */
+void compare_memo(TDBParser& parser, const std::string& sentence,
+                  const std::string& name, Results& results)
+{
+	for(unsigned streaming = 0; streaming < 2; ++streaming)
+	{
+		parser.set_streaming(streaming != 0);
+		parser.set_memo(false);
+		const std::string plain = parse_with(parser,sentence);
+		parser.set_memo(true);
+		const std::string memo = parse_with(parser,sentence);
+		check(plain == memo,name+": '"+sentence+"' mit Tabelle"+
+		      (streaming ? " gestreamt" : ""),results);
+	}
+	parser.set_streaming(false);
+	parser.set_memo(false);
+}
+
+/// Bildet einen Satz aus einem wiederholten Wort und einem Schlusswort
+std::string repeat_word(const std::string& word, const unsigned n,
+                        const std::string& last)
+{
+	std::string sentence;
+	for(unsigned i = 0; i < n; ++i)
+	{
+		sentence += word+" ";
+	}
+	return sentence+last;
+}
+
+/// Lange Rechtsrekursion, vor und am Ende des Satzes
+/** Ohne Grenze wüchse die Tabelle hier quadratisch mit der Satzlänge.
+  */
+void test_memo_right_recursion(const std::string& directory,
+                               Results& results)
+{
+	const std::string grammarfile = directory+"/rechts.pl";
+	const std::string lexiconfile = directory+"/rechts-lexikon.pl";
+	write_file(grammarfile,
+	           "s --> t, z.\n" "s --> t.\n" "t --> w, t.\n" "t --> w.\n");
+	write_file(lexiconfile,"w --> a.\n" "z --> b.\n");
+	TDBParser parser(grammarfile,lexiconfile);
+	parser.set_mode(TDBParser::COUNT);
+	parser.set_memo(true);
+	check(parse_with(parser,repeat_word("a",20000,"b")) == "1\n",
+	      "rechts: 20000 Tokens vor z mit Tabelle",results);
+	check(parse_with(parser,repeat_word("a",20000,"a")) == "1\n",
+	      "rechts: 20001 Tokens am Ende mit Tabelle",results);
+}
+
+/// Linksrekursion, deren Schnitt von der Linkskette vor dem Symbol abhängt
+void test_memo_chain(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/kette.pl";
+	const std::string lexiconfile = directory+"/kette-lexikon.pl";
+	write_file(grammarfile,
+	           "a --> c, x.\n" "a --> x, y.\n" "b --> s, b.\n" "c --> a.\n"
+	           "c --> b.\n" "c --> x.\n" "c --> y, c.\n" "s --> b.\n"
+	           "s --> c, a.\n" "s --> c.\n" "s --> x.\n" "s --> y.\n");
+	write_file(lexiconfile,
+	           "x --> w1.\n" "y --> w1.\n" "x --> w2.\n" "y --> w2.\n"
+	           "x --> w3.\n" "y --> w3.\n" "x --> w4.\n");
+	TDBParser parser(grammarfile,lexiconfile);
+	compare_memo(parser,"w1 w2 w2 w4","kette",results);
+}
+
+/// Einfacher reproduzierbarer Zufallsgenerator
+class Random
+{
+	public:
+
+	/// Konstruktor mit Startwert
+	explicit Random(const unsigned seed) : state(seed)
+	{
+	}
+
+	/// Liefert eine Zahl zwischen 0 und n-1
+	unsigned below(const unsigned n)
+	{
+		state = state*1103515245u+12345u;
+		return (state >> 16) % n;
+	}
+
+	private:
+
+	unsigned state;		///< Zustand
+};
+
+/// Schreibt eine Zufallsgrammatik mit Lexikon und liefert einen Satz dazu
+/** Die Grammatiken haben wenige Symbole und viele Links- und
+  * Rechtsrekursionen sowie einstellige Zyklen.
+    @param seed Startwert des Zufallsgenerators
+    @param grammarfile Datei für die Grammatik
+    @param lexiconfile Datei für das Lexikon
+    @return Satz aus Wörtern des Lexikons
+  */
+std::string write_random_grammar(const unsigned seed,
+                                 const std::string& grammarfile,
+                                 const std::string& lexiconfile)
+{
+	const char* symbols[] = {"s","a","b","c","x","y"};
+	Random random(seed);
+	std::ostringstream grammar;
+	grammar << "s --> x.\n";
+	const unsigned rules = 6+random.below(7);
+	for(unsigned r = 0; r < rules; ++r)
+	{
+		grammar << symbols[random.below(4)] << " -->";
+		const unsigned length = 1+random.below(3);
+		for(unsigned i = 0; i < length; ++i)
+		{
+			grammar << (i > 0 ? ", " : " ") << symbols[random.below(6)];
+		}
+		grammar << ".\n";
+	}
+	std::ostringstream lexicon;
+	for(unsigned w = 1; w <= 4; ++w)
+	{
+		lexicon << "x --> w" << w << ".\n";
+		if(random.below(2) == 0)
+		{
+			lexicon << "y --> w" << w << ".\n";
+		}
+	}
+	std::ostringstream sentence;
+	const unsigned length = 3+random.below(6);
+	for(unsigned i = 0; i < length; ++i)
+	{
+		sentence << (i > 0 ? " " : "") << "w" << 1+random.below(4);
+	}
+	write_file(grammarfile,grammar.str());
+	write_file(lexiconfile,lexicon.str());
+	return sentence.str();
+}
+
+/// Vergleicht die Tabelle mit der Suche ohne sie auf Zufallsgrammatiken
+/** Die Tabelle wird auf diesen Grammatiken oft unter verschiedenen
+  * Linksketten wiederverwendet.
+  */
+void test_memo_random(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/zufall.pl";
+	const std::string lexiconfile = directory+"/zufall-lexikon.pl";
+	for(unsigned seed = 1; seed <= 2000; ++seed)
+	{
+		const std::string sentence =
+			write_random_grammar(seed,grammarfile,lexiconfile);
+		TDBParser parser(grammarfile,lexiconfile);
+		std::ostringstream name;
+		name << "zufall " << seed;
+		compare_memo(parser,sentence,name.str(),results);
+	}
+}
+
+/// Die ersten Bäume mit mehreren Threads
+/** Die Threads liefern die Bäume des Modus FIRST in ihre eigenen
+  * Kontexte, aus denen sie am Ende übernommen werden müssen.
+  */
+void test_first_parallel(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/pp.pl";
+	const std::string lexiconfile = directory+"/pp-lexikon.pl";
+	const std::string outfile = directory+"/pp-baeume.txt";
+	write_file(grammarfile,
+	           "s --> np, vp.\n" "np --> det, n.\n" "np --> det, n, pp.\n"
+	           "vp --> v, np.\n" "vp --> v, np, pp.\n" "pp --> p, np.\n");
+	write_file(lexiconfile,
+	           "det --> der.\n" "det --> die.\n" "det --> dem.\n"
+	           "n --> mann.\n" "n --> frau.\n" "n --> fernrohr.\n"
+	           "n --> park.\n" "n --> stock.\n" "v --> sieht.\n"
+	           "p --> mit.\n" "p --> in.\n");
+	const std::string sentence = "der mann sieht die frau mit dem fernrohr "
+	                             "in dem park mit dem stock";
+	TDBParser parser(grammarfile,lexiconfile);
+	parser.parse(sentence,outfile,1);
+	const std::string all = read_file(outfile);
+	for(unsigned threads = 1; threads <= 3; ++threads)
+	{
+		std::ostringstream name;
+		name << "pp: " << threads << " Threads";
+		parser.set_mode(TDBParser::FIRST,3);
+		parser.parse(sentence,outfile,threads);
+		check(count_lines(read_file(outfile)) == 3,name.str()+", 3 Baeume",
+		      results);
+		parser.set_mode(TDBParser::ALL);
+		parser.parse(sentence,outfile,threads);
+		check(read_file(outfile) == all,name.str()+", alle Baeume",results);
+	}
+	check(count_lines(all) == 4,"pp: 4 Baeume",results);
+}
+
+/// Sehr lange rechtsrekursive Sätze, einzeln und im Stapelbetrieb
+/** Die Listen des Stapels und des Baums werden so lang wie der Satz und
+  * dürfen beim Freigeben den Aufrufstapel nicht überlaufen lassen.
+  */
+void test_deep_input(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/tief.pl";
+	const std::string lexiconfile = directory+"/tief-lexikon.pl";
+	write_file(grammarfile,"s --> w, s.\n" "s --> w.\n");
+	write_file(lexiconfile,"w --> a.\n");
+	const std::string sentence = repeat_word("a",199999,"a");
+	TDBParser parser(grammarfile,lexiconfile);
+	check(count_lines(parse_with(parser,sentence)) == 1,
+	      "tief: 200000 Tokens",results);
+	parser.set_memo(true);
+	check(count_lines(parse_with(parser,sentence)) == 1,
+	      "tief: 200000 Tokens mit Tabelle",results);
+	parser.set_memo(false);
+	std::istringstream corpus(sentence+"\n"+sentence+"\n");
+	std::ostringstream out;
+	parser.parse_corpus(corpus,out);
+	check(count_lines(out.str()) == 4,"tief: Stapelbetrieb",results);
+}
+
+/// Lange Zentraleinbettung mit Earley und CYK
+/** Der Wald ist so tief wie der halbe Satz; Aufbau, Zählen und Aufzählen
+  * dürfen den Aufrufstapel nicht überlaufen lassen. CYK füllt sein Chart
+  * in kubischer Zeit und bekommt daher einen kürzeren Satz.
+  */
+void test_deep_chart(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/einbettung.pl";
+	const std::string lexiconfile = directory+"/einbettung-lexikon.pl";
+	write_file(grammarfile,"s --> a, s, b.\n" "s --> a, b.\n");
+	write_file(lexiconfile,"a --> x.\n" "b --> y.\n");
+	TDBParser backtracking(grammarfile,lexiconfile);
+	const std::string shorter = repeat_word("x",500,repeat_word("y",499,"y"));
+	const std::string all = parse_with(backtracking,shorter);
+	check(count_lines(all) == 1,"einbettung: 1000 Tokens",results);
+
+	const TDBParser::Engine engines[] = {TDBParser::EARLEY,TDBParser::CYK};
+	for(unsigned e = 0; e < 2; ++e)
+	{
+		const std::string name = e == 0 ? "einbettung: earley"
+		                                : "einbettung: cyk";
+		TDBParser parser(grammarfile,lexiconfile,engines[e]);
+		check(parse_with(parser,shorter) == all,name+", 1000 Tokens",results);
+		parser.set_mode(TDBParser::COUNT);
+		check(parse_with(parser,shorter) == "1\n",name+", Anzahl",results);
+	}
+
+	const std::string longer = repeat_word("x",20000,
+	                                       repeat_word("y",19999,"y"));
+	TDBParser earley(grammarfile,lexiconfile,TDBParser::EARLEY);
+	earley.set_mode(TDBParser::COUNT);
+	check(parse_with(earley,longer) == "1\n",
+	      "einbettung: earley, Anzahl bei 40000 Tokens",results);
+	earley.set_mode(TDBParser::FOREST);
+	std::istringstream in(parse_with(earley,longer));
+	ParseForest forest;
+	SymbolTable symbols;
+	SymbolTable tokens;
+	std::ostringstream log;
+	check(forest.read(in,symbols,tokens) && forest.count(symbols,log,2) == 1,
+	      "einbettung: earley, Wald bei 40000 Tokens",results);
+}
+
+/// Liest einen Wald aus einem Text und zählt seine Bäume auf
+/** @param text Wald im Textformat
+    @param trees Bäume, je Baum eine Zeile
+    @return Wald gelesen ja/nein
+  */
+bool read_forest(const std::string& text, std::string& trees)
+{
+	std::istringstream in(text);
+	ParseForest forest;
+	SymbolTable symbols;
+	SymbolTable tokens;
+	if(!forest.read(in,symbols,tokens))
+	{
+		return false;
+	}
+	TreeSet found;
+	std::ostringstream log;
+	forest.trees(found,symbols,tokens,log);
+	trees.clear();
+	for(TreeSet::const_iterator t = found.begin(); t != found.end(); ++t)
+	{
+		trees += *t+"\n";
+	}
+	return true;
+}
+
+/// Fehlerhafte und zyklische Wälder
+/** Fehlerhafte Wälder müssen abgelehnt werden, statt beim Aufzählen
+  * außerhalb der Knoten zu lesen oder endlos zu laufen. Zyklen über
+  * einstellige Regeln schreibt Earley selbst und muss sie wieder lesen.
+  */
+void test_forest_read(const std::string& directory, Results& results)
+{
+	const char* malformed[] = {
+		"wald 2 0\nS s 0 1 -5:1\nT ich 0 1\n",
+		"wald 2 -7\nS s 0 1 -1:1\nT ich 0 1\n",
+		"wald 2 2\nS s 0 1 -1:1\nT ich 0 1\n",
+		"wald 2 0\nS s 0 1 -1:1\nT ich 0 1 -1:0\n",
+		"wald 2 0\nS s 0 2 0:1\nT ich 1 2\n",
+		"wald 2 0\nS s 1 1 -1:1\nT ich 0 1\n",
+		"wald 2 0\nS s 0 1 -1:1 x\nT ich 0 1\n",
+		"wald 3 0\nS s 0 2 -1:1\nZ 1 0 2 -1:2\nZ 2 0 2 -1:1\n",
+		"wald 4 0\nS s 0 2 1:3\nS a 0 2 -1:0\nT ich 0 1\nT du 1 2\n",
+		"wald 3 0\nS s 0 2 -1:1\nS a 0 2 -1:2\nZ 1 0 2 1:0\n"
+	};
+	const unsigned count = sizeof(malformed)/sizeof(malformed[0]);
+	for(unsigned i = 0; i < count; ++i)
+	{
+		std::string trees;
+		std::ostringstream name;
+		name << "wald: fehlerhafter Wald " << i+1 << " abgelehnt";
+		check(!read_forest(malformed[i],trees),name.str(),results);
+	}
+	std::string trees;
+	check(read_forest("wald 3 0\nS s 0 1 -1:1\nS a 0 1 -1:0 -1:2\n"
+	                  "T ich 0 1\n",trees) && trees == "s/[a/[-ich]]\n",
+	      "wald: Zyklus ueber einstellige Regeln",results);
+	check(read_forest("wald 2 0\nS s 0 1 -1:0 -1:1\nT ich 0 1\n",trees) &&
+	      trees == "s/[-ich]\n","wald: Regel s --> s",results);
+	check(read_forest("wald 0 -1\n",trees) && trees.empty(),
+	      "wald: Satz ohne Baum",results);
+
+	const std::string grammarfile = directory+"/zyklus.pl";
+	const std::string lexiconfile = directory+"/zyklus-lexikon.pl";
+	write_file(grammarfile,
+	           "s --> a.\n" "s --> b.\n" "s --> a, b.\n" "a --> b.\n"
+	           "b --> a.\n" "a --> x.\n" "b --> x, b.\n" "b --> b.\n");
+	write_file(lexiconfile,"x --> w.\n");
+	TDBParser parser(grammarfile,lexiconfile);
+	const std::string sentence = "w w w";
+	const std::string expected = parse_with(parser,sentence);
+	parser.set_mode(TDBParser::FOREST);
+	check(read_forest(parse_with(parser,sentence),trees) && trees == expected,
+	      "wald: geschriebener Wald mit Zyklen",results);
+	check(count_lines(expected) > 1,"wald: Baeume mit Zyklen",results);
+}
+
+/// Zählen im gepackten Wald
+/** Earley und CYK dürfen in den Modi COUNT und EXISTS keine Bäume
+  * aufbauen; mit 14 Präpositionalphrasen wären es über eine halbe Million.
+  * Doppelte Regeln ergeben keine zusätzlichen Bäume.
+  */
+void test_forest_count(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/zaehlen.pl";
+	const std::string lexiconfile = directory+"/zaehlen-lexikon.pl";
+	write_file(grammarfile,
+	           "s --> np, vp.\n" "np --> det, n.\n" "np --> det, n, pp.\n"
+	           "np --> det, n, pp, pp.\n" "vp --> v, np.\n"
+	           "vp --> v, np, pp.\n" "vp --> v, np, pp, pp.\n"
+	           "pp --> p, np.\n" "pp --> p, np.\n");
+	write_file(lexiconfile,
+	           "det --> der.\n" "det --> die.\n" "det --> dem.\n"
+	           "n --> mann.\n" "n --> frau.\n" "n --> park.\n"
+	           "v --> sieht.\n" "p --> mit.\n");
+	std::string shorter = "der mann sieht die frau";
+	for(unsigned i = 0; i < 5; ++i)
+	{
+		shorter += " mit dem park";
+	}
+	std::string longer = shorter;
+	for(unsigned i = 5; i < 14; ++i)
+	{
+		longer += " mit dem park";
+	}
+	TDBParser backtracking(grammarfile,lexiconfile);
+	const std::string all = parse_with(backtracking,shorter);
+	std::ostringstream trees;
+	trees << count_lines(all) << "\n";
+	const TDBParser::Engine engines[] = {TDBParser::EARLEY,TDBParser::CYK};
+	for(unsigned e = 0; e < 2; ++e)
+	{
+		const std::string name = e == 0 ? "zaehlen: earley" : "zaehlen: cyk";
+		TDBParser parser(grammarfile,lexiconfile,engines[e]);
+		check(parse_with(parser,shorter) == all,name+", Baeume",results);
+		parser.set_mode(TDBParser::COUNT);
+		check(parse_with(parser,shorter) == trees.str(),
+		      name+", Anzahl wie Backtracking",results);
+		check(parse_with(parser,longer) == "542895\n",
+		      name+", 14 Praepositionalphrasen",results);
+		parser.set_mode(TDBParser::EXISTS);
+		check(parse_with(parser,longer) == "1\n",name+", Existenz",results);
+		check(parse_with(parser,"der mann sieht") == "0\n",
+		      name+", kein Baum",results);
+	}
+}
+
+/// Ergebniszeilen leerer und übersprungener Sätze im Stapelbetrieb
+/** In den Modi COUNT und EXISTS folgt auf jede Kopfzeile genau eine
+  * Ergebniszeile, auch ohne Bäume.
+  */
+void test_corpus_results(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/korpus.pl";
+	const std::string lexiconfile = directory+"/korpus-lexikon.pl";
+	write_file(grammarfile,
+	           "s --> np, vp.\n" "np --> det, n.\n" "vp --> v, np.\n");
+	write_file(lexiconfile,
+	           "det --> der.\n" "det --> die.\n" "n --> mann.\n"
+	           "n --> frau.\n" "v --> sieht.\n");
+	const std::string corpus = "der mann sieht die frau\n\nder hund bellt\n"
+	                           "die frau sieht\n";
+	const TDBParser::Engine engines[] = {TDBParser::BACKTRACKING,
+	                                     TDBParser::EARLEY,TDBParser::CYK};
+	for(unsigned e = 0; e < 3; ++e)
+	{
+		TDBParser parser(grammarfile,lexiconfile,engines[e]);
+		const TDBParser::Mode modes[] = {TDBParser::COUNT,TDBParser::EXISTS};
+		for(unsigned m = 0; m < 2; ++m)
+		{
+			parser.set_mode(modes[m]);
+			std::istringstream in(corpus);
+			std::ostringstream out;
+			// Die Meldung über das unbekannte Wort ist hier erwartet
+			std::ostringstream log;
+			std::streambuf* const cerr = std::cerr.rdbuf(log.rdbuf());
+			parser.parse_corpus(in,out);
+			std::cerr.rdbuf(cerr);
+			std::ostringstream name;
+			name << "korpus: Verfahren " << e << ", Modus " << m;
+			check(out.str() == "% 1: der mann sieht die frau\n1\n"
+			                   "% 2: \n0\n% 3: der hund bellt\n0\n"
+			                   "% 4: die frau sieht\n0\n",name.str(),results);
+		}
+	}
+}
+
+/// Vergleicht alle Verfahren mit dem Backtracking auf Zufallsgrammatiken
+/** Earley, CYK, der geschriebene und wieder gelesene Wald und die
+  * Tabelle müssen dieselben Bäume liefern, COUNT dieselbe Anzahl.
+  */
+void test_engines_random(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/verfahren.pl";
+	const std::string lexiconfile = directory+"/verfahren-lexikon.pl";
+	const TDBParser::Engine engines[] = {TDBParser::EARLEY,TDBParser::CYK};
+	const char* engine_names[] = {"earley","cyk"};
+	for(unsigned seed = 1; seed <= 1000; ++seed)
+	{
+		const std::string sentence =
+			write_random_grammar(seed,grammarfile,lexiconfile);
+		std::ostringstream name;
+		name << "verfahren " << seed << ": '" << sentence << "' ";
+		TDBParser backtracking(grammarfile,lexiconfile);
+		const std::string all = parse_with(backtracking,sentence);
+		backtracking.set_mode(TDBParser::COUNT);
+		const std::string count = parse_with(backtracking,sentence);
+		backtracking.set_mode(TDBParser::ALL);
+		backtracking.set_memo(true);
+		check(parse_with(backtracking,sentence) == all,name.str()+"tabelle",
+		      results);
+
+		for(unsigned e = 0; e < 2; ++e)
+		{
+			TDBParser parser(grammarfile,lexiconfile,engines[e]);
+			check(parse_with(parser,sentence) == all,
+			      name.str()+engine_names[e],results);
+			parser.set_mode(TDBParser::COUNT);
+			check(parse_with(parser,sentence) == count,
+			      name.str()+engine_names[e]+", Anzahl",results);
+			parser.set_mode(TDBParser::FOREST);
+			const std::string forest = parse_with(parser,sentence);
+			std::string trees;
+			check(forest == "?" ? all == "?" :
+			      read_forest(forest,trees) && trees == all,
+			      name.str()+engine_names[e]+", Wald",results);
+		}
+	}
+}
+
+/// Startfunktion eines Threads, der einen Parser mit Cache lädt
+struct CacheLoader
+{
+	std::string grammarfile;	///< Dateiname der Grammatik
+	std::string lexiconfile;	///< Dateiname des Lexikons
+	std::string cachefile;		///< Dateiname des Caches
+	std::string sentence;		///< Zu parsender Satz
+	std::string* output;		///< Ziel für die Bäume
+
+	/// Lädt den Parser und parst den Satz
+	void operator()()
+	{
+		*output = parse_with(TDBParser(grammarfile,lexiconfile,
+		                               TDBParser::BACKTRACKING,cachefile),
+		                     sentence);
+	}
+};
+
+/// Veralteter und beschädigter Cache
+/** Eine Änderung gleicher Größe in derselben Sekunde muss den Cache
+  * veralten lassen, sofern das System Nanosekunden liefert. Beschädigte
+  * Zahlen im Cache dürfen beim Laden und Parsen nie außerhalb der Felder
+  * lesen lassen.
+  */
+void test_cache(const std::string& directory, Results& results)
+{
+	const std::string grammarfile = directory+"/cache.pl";
+	const std::string lexiconfile = directory+"/cache-lexikon.pl";
+	const std::string cachefile = directory+"/cache.bin";
+	const std::string sentence = "der mann sieht die frau";
+	write_file(lexiconfile,
+	           "det --> der.\n" "det --> die.\n" "n --> mann.\n"
+	           "n --> frau.\n" "v --> sieht.\n");
+	write_file(grammarfile,
+	           "s --> np, vp.\n" "np --> det, n.\n" "vp --> v, np.\n");
+	std::remove(cachefile.c_str());
+	const std::string before =
+		parse_with(TDBParser(grammarfile,lexiconfile,TDBParser::BACKTRACKING,
+		                     cachefile),sentence);
+	check(count_lines(before) == 1,"cache: Baum vor der Aenderung",results);
+
+#if defined(__unix__) || defined(__APPLE__)
+	write_file(grammarfile,
+	           "s --> np, vq.\n" "np --> det, n.\n" "vq --> v, np.\n");
+	const std::string after =
+		parse_with(TDBParser(grammarfile,lexiconfile,TDBParser::BACKTRACKING,
+		                     cachefile),sentence);
+	check(after != before && count_lines(after) == 1,
+	      "cache: Aenderung gleicher Groesse in derselben Sekunde",results);
+#endif
+
+	const std::string pristine = read_file(cachefile);
+	const std::string expected =
+		parse_with(TDBParser(grammarfile,lexiconfile),sentence);
+	unsigned rejected = 0;
+	for(unsigned pos = 0; pos+4 <= pristine.size(); pos += 4)
+	{
+		std::string damaged = pristine;
+		damaged.replace(pos,4,"\xff\xff\xff\x7f");
+		write_file(cachefile,damaged);
+		// Ein gültig aussehender Cache darf andere Bäume liefern; ein
+		// abgelehnter wird neu übersetzt und geschrieben
+		const TDBParser parser(grammarfile,lexiconfile,
+		                       TDBParser::BACKTRACKING,cachefile);
+		parse_with(parser,sentence);
+		rejected += read_file(cachefile) == pristine;
+	}
+	check(rejected > 0,"cache: beschaedigte Zahlen abgelehnt",results);
+	write_file(cachefile,pristine);
+	check(parse_with(TDBParser(grammarfile,lexiconfile,
+	                           TDBParser::BACKTRACKING,cachefile),
+	                 sentence) == expected,"cache: unbeschaedigt",results);
+
+	// Mehrere gleichzeitig Schreibende teilen sich keine temporäre Datei;
+	// viele Regeln verlängern das Schreiben
+	std::ostringstream large;
+	large << "s --> np, vp.\n" "np --> det, n.\n" "vp --> v, np.\n";
+	for(unsigned i = 0; i < 3000; ++i)
+	{
+		// Symbolnamen bestehen aus Buchstaben
+		large << 'r';
+		for(unsigned rest = i; rest > 0; rest /= 26)
+		{
+			large << char('a'+rest%26);
+		}
+		large << " --> det, n, v.\n";
+	}
+	write_file(grammarfile,large.str());
+	const std::string single = directory+"/cache-einzeln.bin";
+	std::remove(single.c_str());
+	const std::string trees =
+		parse_with(TDBParser(grammarfile,lexiconfile,TDBParser::BACKTRACKING,
+		                     single),sentence);
+	std::remove(cachefile.c_str());
+	std::vector<std::string> outputs(8);
+	boost::thread_group loaders;
+	for(unsigned i = 0; i < outputs.size(); ++i)
+	{
+		CacheLoader loader = {grammarfile,lexiconfile,cachefile,sentence,
+		                      &outputs[i]};
+		loaders.create_thread(loader);
+	}
+	loaders.join_all();
+	bool same = true;
+	for(unsigned i = 0; i < outputs.size(); ++i)
+	{
+		same = outputs[i] == trees && same;
+	}
+	check(same && count_lines(trees) == 1,"cache: gleichzeitig Schreibende",
+	      results);
+	check(read_file(cachefile) == read_file(single),
+	      "cache: nach gleichzeitigem Schreiben vollstaendig",results);
+}
+
+int main(int argc, const char* argv[])
+{
+	if(argc != 2)
+	{
+		usage();
+	}
+	const std::string directory(argv[1]);
+
+	Results results = {0,0};
+	test_memo_chain(directory,results);
+	test_memo_random(directory,results);
+	test_memo_right_recursion(directory,results);
+	test_first_parallel(directory,results);
+	test_deep_input(directory,results);
+	test_deep_chart(directory,results);
+	test_cache(directory,results);
+	test_forest_read(directory,results);
+	test_forest_count(directory,results);
+	test_corpus_results(directory,results);
+	test_engines_random(directory,results);
+
+	std::cerr << results.run << " Pruefungen, " << results.failed
+	          << " fehlgeschlagen\n";
+	return results.failed == 0 ? 0 : 1;
+}